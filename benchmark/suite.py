@@ -0,0 +1,256 @@
+"""Benchmark suite for pytomlpp.
+
+Times loads, dumps and file load/dump over generated documents of different
+shapes and sizes, and breaks every operation down into its native phases
+(parse, convert, format) using pytomlpp's runtime profiling. Results are
+written as JSON so runs from different releases can be compared.
+
+    python suite.py --sizes 10KB,1MB,100MB --output results.json
+    python suite.py --compare baseline.json results.json
+"""
+
+import argparse
+import importlib.metadata
+import json
+import os
+import platform
+import statistics
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+import pytomlpp
+
+_UNITS = {'B': 1, 'KB': 1024, 'MB': 1024 ** 2, 'GB': 1024 ** 3}
+
+
+def parse_size(text):
+    text = text.strip().upper()
+    for unit in sorted(_UNITS, key=len, reverse=True):
+        if text.endswith(unit):
+            return int(float(text[:-len(unit)]) * _UNITS[unit])
+    return int(text)
+
+
+# Every shape yields the i-th chunk of a document; chunks are appended until the
+# requested size is reached, so all shapes scale to any size.
+
+def _wide(i):
+    header = '[wide]\n' if i == 0 else ''
+    return f'{header}key_{i} = {i}\nname_{i} = "value {i}"\nratio_{i} = {i / 7}\n'
+
+
+def _deep(i):
+    path = '.'.join(f'level{depth}' for depth in range(32))
+    return f'[chunk{i}.{path}]\nvalue = {i}\nflag = {str(i % 2 == 0).lower()}\n'
+
+
+def _array_of_tables(i):
+    return (f'[[items]]\nid = {i}\nname = "item {i}"\nprice = {i * 0.25}\n'
+            f'tags = ["a", "b", "c"]\n')
+
+
+def _datetimes(i):
+    day = i % 28 + 1
+    return (f'offset_{i} = 1979-05-{day:02}T07:32:00-08:00\n'
+            f'local_{i} = 1979-05-{day:02}T07:32:00.999999\n'
+            f'date_{i} = 1979-05-{day:02}\n'
+            f'time_{i} = 07:32:{i % 60:02}\n')
+
+
+def _long_strings(i):
+    return f's_{i} = "{"lorem ipsum dolor sit amet " * 40}"\n'
+
+
+def _numeric_arrays(i):
+    return (f'ints_{i} = [{", ".join(str(i * 64 + j) for j in range(64))}]\n'
+            f'floats_{i} = [{", ".join(str((i + j) / 3) for j in range(64))}]\n')
+
+
+SHAPES = {
+    'wide': _wide,
+    'deep': _deep,
+    'array_of_tables': _array_of_tables,
+    'datetimes': _datetimes,
+    'long_strings': _long_strings,
+    'numeric_arrays': _numeric_arrays,
+}
+
+
+def generate(shape, size):
+    chunk = SHAPES[shape]
+    parts = []
+    length = 0
+    i = 0
+    while length < size:
+        part = chunk(i)
+        parts.append(part)
+        length += len(part)
+        i += 1
+    return ''.join(parts)
+
+
+def _time(func, min_time, repeat):
+    """Returns seconds per call for each of repeat rounds."""
+    start = time.perf_counter()
+    func()
+    once = time.perf_counter() - start
+    number = max(1, int(min_time / once)) if once > 0 else 1000
+    rounds = []
+    for _ in range(repeat):
+        start = time.perf_counter()
+        for _ in range(number):
+            func()
+        rounds.append((time.perf_counter() - start) / number)
+    return rounds
+
+
+def _phases(func):
+    """Runs func once with profiling enabled, returns mean ns per native phase."""
+    was_enabled = pytomlpp.is_profiling_enabled()
+    pytomlpp.reset_stats()
+    pytomlpp.enable_profiling()
+    try:
+        func()
+        stats = pytomlpp.get_stats()
+    finally:
+        pytomlpp.enable_profiling(was_enabled)
+        pytomlpp.reset_stats()
+    phases = {name: phase['mean_ns'] for name, phase in stats['phases'].items()}
+    return phases, stats['counters']
+
+
+OPERATIONS = ('loads', 'loads_lazy', 'dumps', 'dumps_bytes', 'load', 'dump')
+
+
+def _operations(text, data, directory):
+    toml_path = Path(directory, 'doc.toml')
+    toml_path.write_text(text, encoding='utf-8')
+    out_path = Path(directory, 'out.toml')
+    return {
+        'loads': lambda: pytomlpp.loads(text),
+        'loads_lazy': lambda: pytomlpp.loads(text, lazy=True),
+        'dumps': lambda: pytomlpp.dumps(data),
+        'dumps_bytes': lambda: pytomlpp.dumps_bytes(data),
+        'load': lambda: pytomlpp.load(toml_path),
+        'dump': lambda: pytomlpp.dump(data, out_path, mode='wb'),
+    }
+
+
+def run(shapes, sizes, operations, min_time, repeat):
+    results = []
+    with tempfile.TemporaryDirectory() as directory:
+        for shape in shapes:
+            for size in sizes:
+                text = generate(shape, size)
+                data = pytomlpp.loads(text)
+                nbytes = len(text.encode('utf-8'))
+                ops = _operations(text, data, directory)
+                for name in operations:
+                    print(f'  {shape:>16} {nbytes:>11} B {name:>12}...', end='', flush=True,
+                          file=sys.stderr)
+                    rounds = _time(ops[name], min_time, repeat)
+                    phases, counters = _phases(ops[name])
+                    best = min(rounds)
+                    results.append({
+                        'shape': shape,
+                        'bytes': nbytes,
+                        'operation': name,
+                        'seconds': rounds,
+                        'best_seconds': best,
+                        'median_seconds': statistics.median(rounds),
+                        'mb_per_second': nbytes / best / 1024 ** 2,
+                        'phases_ns': phases,
+                        'counters': counters,
+                    })
+                    print(f' {best * 1e3:10.3f} ms ({nbytes / best / 1024 ** 2:8.1f} MB/s)',
+                          file=sys.stderr)
+    return results
+
+
+def package_version():
+    # the package defines no __version__, the installed distribution has it
+    try:
+        return importlib.metadata.version('pytomlpp')
+    except importlib.metadata.PackageNotFoundError:
+        return None
+
+
+def environment():
+    return {
+        'pytomlpp': package_version(),
+        'tomlplusplus': pytomlpp.lib_version,
+        'python': sys.version,
+        'implementation': platform.python_implementation(),
+        'platform': platform.platform(),
+        'machine': platform.machine(),
+        'cpu_count': os.cpu_count(),
+    }
+
+
+def compare(baseline_path, current_path, threshold):
+    """Prints the relative change per case, returns False on any regression."""
+    def load(path):
+        with open(path, encoding='utf-8') as f:
+            recorded = json.load(f)
+        times = {(r['shape'], r['bytes'], r['operation']): r['best_seconds']
+                 for r in recorded['results']}
+        return recorded.get('environment', {}), times
+
+    (baseline_env, baseline), (current_env, current) = load(baseline_path), load(current_path)
+    print(f"pytomlpp {baseline_env.get('pytomlpp')} -> {current_env.get('pytomlpp')}, "
+          f"toml++ {baseline_env.get('tomlplusplus')} -> {current_env.get('tomlplusplus')}")
+    ok = True
+    for key in sorted(baseline.keys() & current.keys()):
+        change = current[key] / baseline[key] - 1
+        regressed = change > threshold
+        ok = ok and not regressed
+        marker = '  REGRESSION' if regressed else ''
+        print(f'{key[0]:>16} {key[1]:>11} B {key[2]:>12}: {change * 100:+7.1f}%{marker}')
+    return ok
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--shapes', default=','.join(SHAPES),
+                        help='comma separated document shapes (default: all)')
+    parser.add_argument('--sizes', default='10KB,1MB',
+                        help='comma separated document sizes, e.g. 10KB,1MB,100MB')
+    parser.add_argument('--operations', default=','.join(OPERATIONS),
+                        help='comma separated operations to time')
+    parser.add_argument('--min-time', type=float, default=0.2,
+                        help='minimum seconds per timing round')
+    parser.add_argument('--repeat', type=int, default=5, help='timing rounds per case')
+    parser.add_argument('--output', help='write the JSON results to this file instead of stdout')
+    parser.add_argument('--compare', nargs=2, metavar=('BASELINE', 'CURRENT'),
+                        help='compare two result files instead of running')
+    parser.add_argument('--threshold', type=float, default=0.1,
+                        help='relative slowdown reported as a regression by --compare')
+    args = parser.parse_args(argv)
+
+    if args.compare:
+        return 0 if compare(*args.compare, args.threshold) else 1
+
+    shapes = [s for s in args.shapes.split(',') if s]
+    unknown = set(shapes) - SHAPES.keys()
+    if unknown:
+        parser.error(f'unknown shapes: {", ".join(sorted(unknown))}')
+    sizes = [parse_size(s) for s in args.sizes.split(',') if s]
+    operations = [o for o in args.operations.split(',') if o]
+    unknown = set(operations) - set(OPERATIONS)
+    if unknown:
+        parser.error(f'unknown operations: {", ".join(sorted(unknown))}')
+
+    print('Running pytomlpp benchmark suite:', file=sys.stderr)
+    results = run(shapes, sizes, operations, args.min_time, args.repeat)
+    report = json.dumps({'environment': environment(), 'results': results}, indent=2)
+    if args.output:
+        Path(args.output).write_text(report, encoding='utf-8')
+    else:
+        print(report)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,101 @@
+#ifndef PYTOMLPP_ARENA_HPP
+#define PYTOMLPP_ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace pytomlpp {
+// Bump allocator for short-lived scratch data: allocation is a pointer bump,
+// deallocation is a no-op and everything is released at once when the arena
+// goes out of scope. The first few KiB come from an inline buffer, so small
+// conversions never hit the heap at all. Not thread-safe.
+class bump_arena {
+  struct alignas(std::max_align_t) block_header {
+    block_header *next;
+  };
+
+  static constexpr size_t block_size = 64 * 1024;
+
+  alignas(std::max_align_t) char inline_buffer_[4096];
+  char *current_ = inline_buffer_;
+  char *end_ = inline_buffer_ + sizeof(inline_buffer_);
+  block_header *blocks_ = nullptr;
+
+  static char *align_up(char *p, size_t alignment) noexcept {
+    const auto address = reinterpret_cast<uintptr_t>(p);
+    return p + ((alignment - address % alignment) % alignment);
+  }
+
+  void *allocate_block(size_t size, size_t alignment) {
+    const size_t payload = std::max(block_size, size + alignment);
+    auto *block = static_cast<block_header *>(
+        ::operator new(sizeof(block_header) + payload));
+    block->next = blocks_;
+    blocks_ = block;
+    char *data = reinterpret_cast<char *>(block + 1);
+    char *result = align_up(data, alignment);
+    // allocations bigger than a block get one of their own and leave the
+    // current block alone
+    if (size + alignment <= block_size) {
+      current_ = result + size;
+      end_ = data + payload;
+    }
+    return result;
+  }
+
+public:
+  bump_arena() noexcept = default;
+  ~bump_arena() noexcept {
+    while (blocks_) {
+      block_header *next = blocks_->next;
+      ::operator delete(blocks_);
+      blocks_ = next;
+    }
+  }
+
+  bump_arena(const bump_arena &) = delete;
+  bump_arena &operator=(const bump_arena &) = delete;
+
+  [[nodiscard]] void *allocate(size_t size, size_t alignment) {
+    char *result = align_up(current_, alignment);
+    if (result + size <= end_) {
+      current_ = result + size;
+      return result;
+    }
+    return allocate_block(size, alignment);
+  }
+};
+
+// std allocator adaptor so containers can live in a bump_arena
+template <typename T> class arena_allocator {
+  template <typename U> friend class arena_allocator;
+  bump_arena *arena_;
+
+public:
+  using value_type = T;
+
+  explicit arena_allocator(bump_arena &arena) noexcept : arena_{&arena} {}
+  template <typename U>
+  arena_allocator(const arena_allocator<U> &other) noexcept
+      : arena_{other.arena_} {}
+
+  [[nodiscard]] T *allocate(size_t n) {
+    static_assert(alignof(T) <= alignof(std::max_align_t));
+    return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T *, size_t) noexcept {}
+
+  template <typename U>
+  bool operator==(const arena_allocator<U> &other) const noexcept {
+    return arena_ == other.arena_;
+  }
+  template <typename U>
+  bool operator!=(const arena_allocator<U> &other) const noexcept {
+    return arena_ != other.arena_;
+  }
+};
+} // namespace pytomlpp
+
+#endif // PYTOMLPP_ARENA_HPP
@@ -0,0 +1,32 @@
+#ifndef PYTOMLPP_HASH_HPP
+#define PYTOMLPP_HASH_HPP
+
+#include <cstdint>
+#include <string_view>
+
+namespace pytomlpp {
+// 64-bit FNV-1a; incremental, so text can be hashed as it streams past.
+class fnv1a {
+  uint64_t state_ = 0xcbf29ce484222325ull;
+
+public:
+  void update(std::string_view data) noexcept {
+    uint64_t state = state_;
+    for (const char c : data) {
+      state ^= static_cast<unsigned char>(c);
+      state *= 0x100000001b3ull;
+    }
+    state_ = state;
+  }
+
+  [[nodiscard]] uint64_t value() const noexcept { return state_; }
+};
+
+[[nodiscard]] inline uint64_t fnv1a_hash(std::string_view data) noexcept {
+  fnv1a hash;
+  hash.update(data);
+  return hash.value();
+}
+} // namespace pytomlpp
+
+#endif // PYTOMLPP_HASH_HPP
@@ -0,0 +1,137 @@
+#ifndef PYTOMLPP_IO_HPP
+#define PYTOMLPP_IO_HPP
+
+#include <pytomlpp/hash.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+namespace pytomlpp {
+// Whole contents of a file (or pipe), read into memory. Files are not
+// memory-mapped: one truncated by another process while it is parsed would
+// kill the interpreter with SIGBUS, where a copy at worst fails to parse.
+// Never throws and does not need the GIL; check error() before view().
+class file_contents {
+  std::string data_;
+  int error_ = 0;
+
+public:
+  explicit file_contents(const std::string &path) noexcept;
+
+  file_contents(const file_contents &) = delete;
+  file_contents &operator=(const file_contents &) = delete;
+
+  // errno (GetLastError() on windows) of the failed call, 0 on success
+  [[nodiscard]] int error() const noexcept { return error_; }
+  [[nodiscard]] std::string_view view() const noexcept { return data_; }
+};
+
+// Size and modification time of a file, used to tell whether it changed.
+struct file_stamp {
+  uint64_t size = 0;
+  int64_t mtime_ns = 0;
+
+  [[nodiscard]] bool operator==(const file_stamp &other) const noexcept {
+    return size == other.size && mtime_ns == other.mtime_ns;
+  }
+  [[nodiscard]] bool operator!=(const file_stamp &other) const noexcept {
+    return !(*this == other);
+  }
+};
+
+// Fills stamp for path without opening it; does not need the GIL. Returns 0
+// or an error code in the same convention as file_contents::error().
+[[nodiscard]] int stat_file(const std::string &path,
+                            file_stamp &stamp) noexcept;
+
+// Raises the python OSError matching a file_contents error code.
+[[noreturn]] void throw_os_error(int error_code, const std::string &path);
+
+// Output stream buffer which collects formatted text in a fixed-size chunk and
+// hands every full chunk to write_chunk(). Once a write fails all further
+// output is dropped and finish() reports the failure.
+class output_sink : public std::streambuf {
+  std::unique_ptr<char[]> buffer_;
+  size_t capacity_;
+  size_t bytes_written_ = 0;
+  bool failed_ = false;
+
+  bool flush_buffer();
+
+protected:
+  // writes all of [data, data + size), returns false on failure
+  virtual bool write_chunk(const char *data, size_t size) = 0;
+
+  int_type overflow(int_type ch) override;
+  std::streamsize xsputn(const char *data, std::streamsize size) override;
+  int sync() override;
+
+public:
+  explicit output_sink(size_t capacity = 64 * 1024);
+
+  // flushes the pending chunk, returns false if any write failed
+  [[nodiscard]] bool finish();
+
+  // bytes successfully handed to write_chunk() so far
+  [[nodiscard]] size_t bytes_written() const noexcept { return bytes_written_; }
+};
+
+// output_sink writing to a file descriptor; does not need the GIL.
+class fd_sink final : public output_sink {
+  int fd_;
+  int error_ = 0;
+
+protected:
+  bool write_chunk(const char *data, size_t size) override;
+
+public:
+  explicit fd_sink(int fd) noexcept : fd_{fd} {}
+
+  // errno of the failed write, 0 on success
+  [[nodiscard]] int error() const noexcept { return error_; }
+};
+
+// Stream buffer appending straight into a std::string, optionally hashing
+// the text as it is written.
+class string_sink final : public std::streambuf {
+  std::string &out_;
+  fnv1a *hash_;
+
+protected:
+  int_type overflow(int_type ch) override;
+  std::streamsize xsputn(const char *data, std::streamsize size) override;
+
+public:
+  explicit string_sink(std::string &out, fnv1a *hash = nullptr) noexcept
+      : out_{out}, hash_{hash} {}
+};
+
+// Creates or truncates path for writing; returns -1 and sets errno on failure.
+[[nodiscard]] int open_for_writing(const std::string &path) noexcept;
+// Path of the file path refers to once symbolic links are followed, so that
+// renaming a replacement over it updates the linked-to file instead of
+// replacing the link; path itself when it does not exist (yet).
+[[nodiscard]] std::string resolve_symlinks(const std::string &path);
+// Creates a new file for writing in the directory of target, so it can then
+// be renamed over it, and stores its name in temp_path. On POSIX it gets the
+// permission bits of an existing target. Returns -1 and sets errno on failure.
+[[nodiscard]] int open_temporary(const std::string &target,
+                                 std::string &temp_path) noexcept;
+// Flushes the data written to fd to the disk; returns 0 or errno.
+[[nodiscard]] int sync_file(int fd) noexcept;
+// Closes fd; returns 0 on success, errno otherwise.
+[[nodiscard]] int close_file(int fd) noexcept;
+// Atomically replaces target with path. Returns 0 or an error code in the
+// same convention as file_contents::error().
+[[nodiscard]] int replace_file(const std::string &path,
+                               const std::string &target) noexcept;
+// Deletes path, ignoring failures; used to clean up temporary files.
+void remove_file(const std::string &path) noexcept;
+// Raises the python OSError matching an errno value.
+[[noreturn]] void throw_errno_error(int error_code, const std::string &path);
+} // namespace pytomlpp
+
+#endif // PYTOMLPP_IO_HPP
@@ -0,0 +1,43 @@
+#ifndef PYTOMLPP_LOCKING_HPP
+#define PYTOMLPP_LOCKING_HPP
+
+#include <pytomlpp/pytomlpp.hpp>
+#include <mutex>
+
+namespace pytomlpp {
+// Locks a mutex guarding native state shared between python threads. When it
+// is contended the thread detaches from the interpreter (drops the GIL, or
+// lets a free-threaded stop-the-world pause proceed) while it waits, so the
+// holder can always get back into python and finish. The GIL must be held.
+[[nodiscard]] inline std::unique_lock<std::mutex>
+lock_detached(std::mutex &mutex) {
+  std::unique_lock<std::mutex> lock{mutex, std::try_to_lock};
+  if (!lock.owns_lock()) {
+    py::gil_scoped_release release;
+    lock.lock();
+  }
+  return lock;
+}
+
+// Holds the per-object lock of a builtin container on free-threaded builds
+// while borrowed references into it are taken, like Py_BEGIN_CRITICAL_SECTION
+// but also released when a conversion throws. Does nothing with the GIL.
+class critical_section {
+#ifdef Py_GIL_DISABLED
+  PyCriticalSection section;
+
+public:
+  explicit critical_section(py::handle obj) noexcept {
+    PyCriticalSection_Begin(&section, obj.ptr());
+  }
+  ~critical_section() noexcept { PyCriticalSection_End(&section); }
+#else
+public:
+  explicit critical_section(py::handle) noexcept {}
+#endif
+  critical_section(const critical_section &) = delete;
+  critical_section &operator=(const critical_section &) = delete;
+};
+} // namespace pytomlpp
+
+#endif // PYTOMLPP_LOCKING_HPP
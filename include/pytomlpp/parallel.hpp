@@ -0,0 +1,47 @@
+#ifndef PYTOMLPP_PARALLEL_HPP
+#define PYTOMLPP_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace pytomlpp {
+// Runs func(index) for every index in [0, count) on up to max_threads native
+// threads (0 means one per hardware thread); the calling thread takes part in
+// the work. func must not throw and must not touch the python interpreter.
+template <typename Func>
+void parallel_for(size_t count, size_t max_threads, Func &&func) {
+  if (max_threads == 0)
+    max_threads = std::max(1u, std::thread::hardware_concurrency());
+  const size_t thread_count = std::min(count, max_threads);
+  if (thread_count <= 1) {
+    for (size_t i = 0; i < count; i++)
+      func(i);
+    return;
+  }
+
+  std::atomic<size_t> next_index{0};
+  auto worker = [&]() {
+    for (size_t i = next_index.fetch_add(1, std::memory_order_relaxed);
+         i < count; i = next_index.fetch_add(1, std::memory_order_relaxed))
+      func(i);
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  try {
+    for (size_t i = 1; i < thread_count; i++)
+      threads.emplace_back(worker);
+  } catch (const std::system_error &) {
+    // out of threads; whoever did start (and this thread) picks up the rest
+  }
+  worker();
+  for (auto &thread : threads)
+    thread.join();
+}
+} // namespace pytomlpp
+
+#endif // PYTOMLPP_PARALLEL_HPP
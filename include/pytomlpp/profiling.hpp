@@ -0,0 +1,89 @@
+#ifndef PYTOMLPP_PROFILING_HPP
+#define PYTOMLPP_PROFILING_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace pytomlpp::profiling {
+inline constexpr size_t histogram_buckets = 40; // 1ns .. ~9min, powers of two
+
+// Timing statistics of one profiled scope. Phases are registered on first use
+// and live for the rest of the process; every field is atomic so scopes that
+// run with the GIL released can record concurrently.
+struct phase_stats {
+  const char *name;
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> total_ns{0};
+  std::atomic<uint64_t> min_ns{std::numeric_limits<uint64_t>::max()};
+  std::atomic<uint64_t> max_ns{0};
+  std::atomic<uint64_t> histogram[histogram_buckets] = {};
+
+  explicit phase_stats(const char *name) noexcept : name{name} {}
+
+  void record(uint64_t elapsed_ns) noexcept;
+  void reset() noexcept;
+};
+
+enum class counter : size_t {
+  bytes_in,      // toml text handed to the parser
+  bytes_out,     // toml text produced by the formatter
+  nodes_decoded, // toml values converted to python objects
+  nodes_encoded, // python values converted to toml values
+  count_
+};
+
+extern std::atomic<bool> enabled;
+extern std::atomic<uint64_t> counters[static_cast<size_t>(counter::count_)];
+
+[[nodiscard]] inline bool is_enabled() noexcept {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+inline void add(counter which, uint64_t amount) noexcept {
+  if (is_enabled())
+    counters[static_cast<size_t>(which)].fetch_add(amount,
+                                                   std::memory_order_relaxed);
+}
+
+// thread-safe, the returned reference stays valid forever
+[[nodiscard]] phase_stats &register_phase(const char *name);
+
+// Times the enclosing scope into a phase, if profiling was enabled when the
+// scope was entered. Costs one relaxed atomic load when disabled.
+class scope_timer {
+  phase_stats *stats;
+  std::chrono::steady_clock::time_point start;
+
+public:
+  explicit scope_timer(phase_stats &phase) noexcept
+      : stats{is_enabled() ? &phase : nullptr} {
+    if (stats)
+      start = std::chrono::steady_clock::now();
+  }
+
+  ~scope_timer() noexcept {
+    if (stats)
+      stats->record(static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count()));
+  }
+
+  scope_timer(const scope_timer &) = delete;
+  scope_timer &operator=(const scope_timer &) = delete;
+};
+} // namespace pytomlpp::profiling
+
+#define PROFILE_SCOPE_2(line, name)                                            \
+  static auto &profiling_phase##line =                                         \
+      pytomlpp::profiling::register_phase(name);                               \
+  pytomlpp::profiling::scope_timer profiling_timer##line {                     \
+    profiling_phase##line                                                      \
+  }
+#define PROFILE_SCOPE_1(line, name) PROFILE_SCOPE_2(line, name)
+#define PROFILE_SCOPE(name) PROFILE_SCOPE_1(__LINE__, name)
+
+#endif // PYTOMLPP_PROFILING_HPP
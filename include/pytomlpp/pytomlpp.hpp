@@ -9,7 +9,9 @@
 #endif
 #endif // PYTOMLPP_USE_TL_OPTIONAL
 #ifndef PYTOMLPP_PROFILING
-#define PYTOMLPP_PROFILING 0 // see a profiling summary on shutdown
+// profiling is always available at runtime (pytomlpp.enable_profiling());
+// building with 1 turns it on at import and prints a summary on shutdown
+#define PYTOMLPP_PROFILING 0
 #endif
 
 // toml++ config
@@ -47,16 +49,59 @@ namespace pytomlpp {
 using namespace pybind11::literals;
 
 [[nodiscard]] py::list toml_array_to_py_list(toml::array &&);
-[[nodiscard]] py::dict toml_table_to_py_dict(toml::table &&);
+// numeric_buffers: homogeneous integer/float arrays become array.array('q'/'d')
+[[nodiscard]] py::dict toml_table_to_py_dict(toml::table &&,
+                                             bool numeric_buffers = false);
+[[nodiscard]] py::dict toml_table_to_py_dict(const toml::table &);
+[[nodiscard]] py::object toml_node_to_py(const toml::node &);
 [[nodiscard]] toml::table py_dict_to_toml_table(const py::dict &);
 [[nodiscard]] toml::array py_list_to_toml_array(const py::list &);
+// accepts a dict or any collections.abc.Mapping
+[[nodiscard]] toml::table py_mapping_to_toml_table(py::handle);
+// converts any value dumps accepts and stores it in an existing table
+void insert_py_value(toml::table &, std::string_view key, py::handle value);
+// looks up collections.abc and array types once at module init
+void import_abc_types();
+// utf-8 view of a str or bytes object; only valid while the object is alive
+[[nodiscard]] std::string_view document_view(py::handle);
+
+// datetime types, looked up once by import_datetime() at module init
+struct datetime_types {
+  PyTypeObject *date;
+  PyTypeObject *time;
+  PyTypeObject *datetime;
+};
+void import_datetime();
+[[nodiscard]] const datetime_types &py_datetime_types() noexcept;
+
+// read-only Mapping over a parsed table which converts values on first access
+[[nodiscard]] py::object make_lazy_table(std::shared_ptr<const toml::table>);
+void register_lazy_table(py::module &);
+
+// enable_profiling/get_stats/reset_stats bindings (profiling.cpp)
+void register_profiling(py::module &);
+
+// CachedLoader class binding (cached_loader.cpp)
+void register_cached_loader(py::module &);
+
+// native toml <-> json transcoding bindings (json.cpp)
+void register_json(py::module &);
+
+// SchemaPlan class and loads_as bindings (schema.cpp)
+void register_schema(py::module &);
+
+// Document class binding (document.cpp)
+void register_document(py::module &);
+
+// IncrementalParser class binding (incremental_parser.cpp)
+void register_incremental_parser(py::module &);
 
 struct DecodeError : public std::exception {
   std::string err_message;
-  int start_line;
-  int start_col;
-  int end_line;
-  int end_col;
+  int start_line = 0;
+  int start_col = 0;
+  int end_line = 0;
+  int end_col = 0;
   std::shared_ptr<const std::string> path;
 
   DecodeError(const std::string &message) noexcept : err_message(message) {}
@@ -69,6 +114,14 @@ struct DecodeError : public std::exception {
 
   const char *what() const noexcept override { return err_message.c_str(); }
 };
+
+// raised by loads_as when the document does not match the schema
+struct SchemaError : public DecodeError {
+  using DecodeError::DecodeError;
+};
+
+// throws the DecodeError (with source positions) for a toml++ parse error
+[[noreturn]] void throw_decode_error(const toml::parse_error &);
 } // namespace pytomlpp
 
 namespace pybind11::detail {
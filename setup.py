@@ -30,7 +30,19 @@ setup(
     ext_modules=[
         Extension(
             'pytomlpp._impl',
-            ['src/pytomlpp.cpp', 'src/type_casters.cpp', 'src/encoding_decoding.cpp'],
+            [
+                'src/pytomlpp.cpp',
+                'src/type_casters.cpp',
+                'src/encoding_decoding.cpp',
+                'src/io.cpp',
+                'src/lazy_table.cpp',
+                'src/profiling.cpp',
+                'src/cached_loader.cpp',
+                'src/json.cpp',
+                'src/schema.cpp',
+                'src/document.cpp',
+                'src/incremental_parser.cpp',
+            ],
             include_dirs=[
                 dir_path + '/include',
                 dir_path + '/third_party',
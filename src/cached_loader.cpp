@@ -0,0 +1,203 @@
+#include <pytomlpp/pytomlpp.hpp>
+#include <pytomlpp/hash.hpp>
+#include <pytomlpp/io.hpp>
+#include <pytomlpp/profiling.hpp>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+PYTOMLPP_PUSH_OPTIMIZATIONS;
+
+namespace {
+using table_ptr = std::shared_ptr<const toml::table>;
+
+py::handle fsencode;
+
+struct cache_entry {
+  std::string path;
+  pytomlpp::file_stamp stamp;
+  uint64_t hash;
+  size_t bytes; // source size, an estimate of the tree's footprint
+  table_ptr table;
+};
+
+// LRU cache of parsed documents. A lookup only stats the file: if size and
+// mtime match the cached entry the tree is reused as is, otherwise the file is
+// read and hashed, and only parsed again when its content actually changed.
+// Cached trees are immutable and shared, so they are converted without the
+// lock held; the lock is never held while parsing or touching python objects.
+class cached_loader {
+  using entry_list = std::list<cache_entry>;
+
+  const size_t max_bytes;
+  std::mutex mutex;
+  entry_list entries; // most recently used first
+  std::unordered_map<std::string, entry_list::iterator> index;
+  size_t total_bytes = 0;
+  uint64_t hits = 0;
+  uint64_t content_hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+
+  // entry for path, moved to the front; entries.end() if there is none
+  entry_list::iterator touch(const std::string &path) {
+    const auto it = index.find(path);
+    if (it == index.end())
+      return entries.end();
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second;
+  }
+
+  void erase(entry_list::iterator entry) {
+    total_bytes -= entry->bytes;
+    index.erase(entry->path);
+    entries.erase(entry);
+  }
+
+  table_ptr find_by_stamp(const std::string &path,
+                          const pytomlpp::file_stamp &stamp) {
+    std::lock_guard<std::mutex> lock{mutex};
+    const auto entry = touch(path);
+    if (entry == entries.end() || entry->stamp != stamp)
+      return nullptr;
+    hits++;
+    return entry->table;
+  }
+
+  // the file was touched but may still hold the same bytes
+  table_ptr find_by_hash(const std::string &path,
+                         const pytomlpp::file_stamp &stamp, uint64_t hash) {
+    std::lock_guard<std::mutex> lock{mutex};
+    const auto entry = touch(path);
+    if (entry == entries.end() || entry->hash != hash) {
+      misses++;
+      return nullptr;
+    }
+    entry->stamp = stamp;
+    content_hits++;
+    return entry->table;
+  }
+
+  void insert(cache_entry &&new_entry) {
+    std::lock_guard<std::mutex> lock{mutex};
+    if (const auto entry = touch(new_entry.path); entry != entries.end())
+      erase(entry);
+    if (new_entry.bytes > max_bytes)
+      return;
+    total_bytes += new_entry.bytes;
+    entries.push_front(std::move(new_entry));
+    index.emplace(entries.front().path, entries.begin());
+    while (total_bytes > max_bytes) {
+      erase(std::prev(entries.end()));
+      evictions++;
+    }
+  }
+
+  // called with the GIL released; returns nullptr and sets error_code if the
+  // file cannot be read, throws toml::parse_error if it is not valid toml
+  table_ptr fetch(const std::string &path, int &error_code) {
+    pytomlpp::file_stamp stamp;
+    if ((error_code = pytomlpp::stat_file(path, stamp)))
+      return nullptr;
+    if (auto table = find_by_stamp(path, stamp))
+      return table;
+
+    pytomlpp::file_contents file{path};
+    if ((error_code = file.error()))
+      return nullptr;
+    const uint64_t hash = pytomlpp::fnv1a_hash(file.view());
+    if (auto table = find_by_hash(path, stamp, hash))
+      return table;
+
+    pytomlpp::profiling::add(pytomlpp::profiling::counter::bytes_in,
+                             file.view().size());
+    auto table = std::make_shared<const toml::table>(
+        toml::parse(file.view(), std::string_view{path}));
+    insert({path, stamp, hash, file.view().size(), table});
+    return table;
+  }
+
+public:
+  explicit cached_loader(size_t max_bytes) noexcept : max_bytes{max_bytes} {}
+
+  py::object load(const py::object &path_like, bool lazy) {
+    const auto path = fsencode(path_like).cast<std::string>();
+    try {
+      PROFILE_SCOPE("cached_load.total");
+      table_ptr table;
+      int error_code = 0;
+      {
+        PROFILE_SCOPE("cached_load.fetch");
+        py::gil_scoped_release release;
+        table = fetch(path, error_code);
+      }
+      if (error_code)
+        pytomlpp::throw_os_error(error_code, path);
+      PROFILE_SCOPE("cached_load.convert");
+      if (lazy)
+        return pytomlpp::make_lazy_table(std::move(table));
+      return pytomlpp::toml_table_to_py_dict(*table);
+    } catch (const toml::parse_error &e) {
+      pytomlpp::throw_decode_error(e);
+    }
+  }
+
+  void invalidate(const py::object &path_like) {
+    const auto path = fsencode(path_like).cast<std::string>();
+    std::lock_guard<std::mutex> lock{mutex};
+    if (const auto it = index.find(path); it != index.end())
+      erase(it->second);
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock{mutex};
+    index.clear();
+    entries.clear();
+    total_bytes = 0;
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> lock{mutex};
+    return entries.size();
+  }
+
+  py::dict stats() {
+    uint64_t counts[4];
+    size_t entry_count = 0;
+    size_t bytes = 0;
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      counts[0] = hits;
+      counts[1] = content_hits;
+      counts[2] = misses;
+      counts[3] = evictions;
+      entry_count = entries.size();
+      bytes = total_bytes;
+    }
+    py::dict result;
+    result["hits"] = counts[0];
+    result["content_hits"] = counts[1];
+    result["misses"] = counts[2];
+    result["evictions"] = counts[3];
+    result["entries"] = entry_count;
+    result["bytes"] = bytes;
+    result["max_bytes"] = max_bytes;
+    return result;
+  }
+};
+} // namespace
+
+namespace pytomlpp {
+void register_cached_loader(py::module &m) {
+  fsencode = py::module::import("os").attr("fsencode").release();
+
+  py::class_<cached_loader>(m, "CachedLoader")
+      .def(py::init<size_t>(), py::arg("max_bytes") = size_t{64} << 20)
+      .def("load", &cached_loader::load, py::arg("path"),
+           py::arg("lazy") = false)
+      .def("invalidate", &cached_loader::invalidate, py::arg("path"))
+      .def("clear", &cached_loader::clear)
+      .def("stats", &cached_loader::stats)
+      .def("__len__", &cached_loader::size);
+}
+} // namespace pytomlpp
@@ -0,0 +1,308 @@
+#include <pytomlpp/pytomlpp.hpp>
+#include <pytomlpp/io.hpp>
+#include <pytomlpp/locking.hpp>
+#include <pytomlpp/profiling.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+PYTOMLPP_PUSH_OPTIMIZATIONS;
+
+namespace {
+py::handle fsencode;
+py::handle fsdecode;
+
+// one step of a key path: a table key, or an array index written as "[n]"
+struct path_step {
+  std::string_view key;
+  size_t index = 0;
+  bool is_index = false;
+};
+
+// splits "servers[0].host" into its steps; keys cannot contain '.' or '['
+std::vector<path_step> split_path(std::string_view path) {
+  auto malformed = [&]() {
+    throw py::value_error("invalid key path '" + std::string{path} + "'");
+  };
+  std::vector<path_step> steps;
+  size_t pos = 0;
+  for (;;) {
+    path_step step;
+    if (pos < path.size() && path[pos] == '[') {
+      const size_t close = path.find(']', pos);
+      if (close == std::string_view::npos || close == pos + 1)
+        malformed();
+      step.is_index = true;
+      for (pos++; pos < close; pos++) {
+        if (path[pos] < '0' || path[pos] > '9')
+          malformed();
+        step.index = step.index * 10 + static_cast<size_t>(path[pos] - '0');
+      }
+      pos++;
+    } else {
+      const size_t end = std::min(path.find('.', pos), path.find('[', pos));
+      step.key = path.substr(pos, end - pos);
+      if (step.key.empty())
+        malformed();
+      pos += step.key.size();
+    }
+    steps.push_back(step);
+    if (pos == path.size())
+      return steps;
+    if (path[pos] == '.')
+      pos++;
+    else if (path[pos] != '[')
+      malformed();
+  }
+}
+
+// Parsed document edited in place: reads and writes by key path only convert
+// the values involved, and save() formats the C++ tree straight to disk.
+// toml++ does not keep comments, and tables are written with sorted keys.
+class document {
+  std::mutex mutex; // guards root
+  toml::table root;
+  const std::string path; // file the document was loaded from, empty for text
+
+  // child of node for one step, or nullptr if it does not exist
+  static toml::node *child(toml::node &node, const path_step &step) {
+    if (step.is_index) {
+      toml::array *arr = node.as_array();
+      return arr ? arr->get(step.index) : nullptr;
+    }
+    toml::table *t = node.as_table();
+    return t ? t->get(step.key) : nullptr;
+  }
+
+  // node at path, or nullptr if any step is missing
+  toml::node *find(const std::vector<path_step> &steps) {
+    toml::node *node = &root;
+    for (const path_step &step : steps) {
+      node = child(*node, step);
+      if (!node)
+        return nullptr;
+    }
+    return node;
+  }
+
+  [[noreturn]] static void missing(const std::string &key_path) {
+    throw py::key_error(key_path);
+  }
+
+public:
+  document(toml::table &&root, std::string path) noexcept
+      : root{std::move(root)}, path{std::move(path)} {}
+
+  static std::unique_ptr<document> from_text(const py::object &data) {
+    const std::string_view text = pytomlpp::document_view(data);
+    pytomlpp::profiling::add(pytomlpp::profiling::counter::bytes_in,
+                             text.size());
+    try {
+      py::gil_scoped_release release;
+      return std::make_unique<document>(toml::parse(text), std::string{});
+    } catch (const toml::parse_error &e) {
+      pytomlpp::throw_decode_error(e);
+    }
+  }
+
+  static std::unique_ptr<document> from_file(const py::object &path_like) {
+    PROFILE_SCOPE("document.load");
+    auto path = fsencode(path_like).cast<std::string>();
+    toml::table root;
+    int error_code = 0;
+    try {
+      py::gil_scoped_release release;
+      pytomlpp::file_contents file{path};
+      if (!(error_code = file.error())) {
+        pytomlpp::profiling::add(pytomlpp::profiling::counter::bytes_in,
+                                 file.view().size());
+        root = toml::parse(file.view(), std::string_view{path});
+      }
+    } catch (const toml::parse_error &e) {
+      pytomlpp::throw_decode_error(e);
+    }
+    if (error_code)
+      pytomlpp::throw_os_error(error_code, path);
+    return std::make_unique<document>(std::move(root), std::move(path));
+  }
+
+  py::object get(const std::string &key_path, const py::object &fallback) {
+    const auto steps = split_path(key_path);
+    auto lock = pytomlpp::lock_detached(mutex);
+    const toml::node *node = find(steps);
+    return node ? pytomlpp::toml_node_to_py(*node) : fallback;
+  }
+
+  py::object get_item(const std::string &key_path) {
+    const auto steps = split_path(key_path);
+    auto lock = pytomlpp::lock_detached(mutex);
+    const toml::node *node = find(steps);
+    if (!node)
+      missing(key_path);
+    return pytomlpp::toml_node_to_py(*node);
+  }
+
+  bool contains(const std::string &key_path) {
+    const auto steps = split_path(key_path);
+    auto lock = pytomlpp::lock_detached(mutex);
+    return find(steps) != nullptr;
+  }
+
+  // missing tables along the path are created; array indices must exist
+  void set(const std::string &key_path, const py::handle &value) {
+    const auto steps = split_path(key_path);
+    // converted before locking, a Mapping or Sequence may run python code
+    toml::table converted;
+    pytomlpp::insert_py_value(converted, "value", value);
+    toml::node &new_value = *converted.get("value");
+
+    auto lock = pytomlpp::lock_detached(mutex);
+    // walk the existing part of the path, then check the rest can be created
+    // before creating anything, so a failing call leaves the document as is
+    toml::node *node = &root;
+    size_t depth = 0;
+    for (; depth + 1 < steps.size(); depth++) {
+      toml::node *next = child(*node, steps[depth]);
+      if (!next)
+        break;
+      node = next;
+    }
+    if (depth + 1 < steps.size()) {
+      // missing tables go into a table and are reached by keys only
+      const bool creatable =
+          node->is_table() &&
+          std::none_of(steps.begin() + static_cast<ptrdiff_t>(depth),
+                       steps.end(),
+                       [](const path_step &step) { return step.is_index; });
+      if (!creatable)
+        missing(key_path);
+      for (; depth + 1 < steps.size(); depth++) {
+        toml::table *t = node->as_table();
+        t->insert(steps[depth].key, toml::table{});
+        node = t->get(steps[depth].key);
+      }
+    }
+    const path_step &last = steps.back();
+    if (last.is_index) {
+      toml::array *arr = node->as_array();
+      if (!arr || last.index >= arr->size())
+        missing(key_path);
+      arr->replace(arr->cbegin() + static_cast<ptrdiff_t>(last.index),
+                   std::move(new_value));
+    } else {
+      toml::table *t = node->as_table();
+      if (!t)
+        missing(key_path);
+      t->insert_or_assign(last.key, std::move(new_value));
+    }
+  }
+
+  void remove(const std::string &key_path) {
+    auto steps = split_path(key_path);
+    const path_step last = steps.back();
+    steps.pop_back();
+    auto lock = pytomlpp::lock_detached(mutex);
+    toml::node *parent = find(steps);
+    bool removed = false;
+    if (parent && last.is_index) {
+      toml::array *arr = parent->as_array();
+      removed = arr && last.index < arr->size();
+      if (removed)
+        arr->erase(arr->cbegin() + static_cast<ptrdiff_t>(last.index));
+    } else if (parent) {
+      toml::table *t = parent->as_table();
+      removed = t && t->erase(last.key) > 0;
+    }
+    if (!removed)
+      missing(key_path);
+  }
+
+  std::string dumps() {
+    auto lock = pytomlpp::lock_detached(mutex);
+    std::string out;
+    pytomlpp::string_sink sink{out};
+    std::ostream os{&sink};
+    os << root;
+    return out;
+  }
+
+  py::dict to_dict() {
+    auto lock = pytomlpp::lock_detached(mutex);
+    return pytomlpp::toml_table_to_py_dict(root);
+  }
+
+  // writes to path_like, or back to the file the document was loaded from
+  void save(const py::object &path_like) {
+    PROFILE_SCOPE("document.save");
+    std::string target = path;
+    if (!path_like.is_none())
+      target = fsencode(path_like).cast<std::string>();
+    else if (target.empty())
+      throw py::value_error("document was not loaded from a file, pass a path");
+    // formatted under the lock, the I/O happens without it
+    const std::string text = dumps();
+    // written to a temporary file renamed over the target, so a failed or
+    // interrupted save never leaves a truncated document behind
+    int error_code = 0;    // errno
+    int replace_error = 0; // file_contents::error() convention
+    {
+      py::gil_scoped_release release;
+      // a symlinked target keeps its link, the file it points to is replaced
+      const std::string resolved = pytomlpp::resolve_symlinks(target);
+      std::string temp_path;
+      const int fd = pytomlpp::open_temporary(resolved, temp_path);
+      if (fd < 0) {
+        error_code = errno;
+      } else {
+        pytomlpp::fd_sink sink{fd};
+        sink.sputn(text.data(), static_cast<std::streamsize>(text.size()));
+        if (!sink.finish())
+          error_code = sink.error();
+        else
+          error_code = pytomlpp::sync_file(fd);
+        if (const int close_error = pytomlpp::close_file(fd); !error_code)
+          error_code = close_error;
+        if (!error_code)
+          replace_error = pytomlpp::replace_file(temp_path, resolved);
+        if (error_code || replace_error)
+          pytomlpp::remove_file(temp_path);
+      }
+    }
+    if (error_code)
+      pytomlpp::throw_errno_error(error_code, target);
+    if (replace_error)
+      pytomlpp::throw_os_error(replace_error, target);
+    pytomlpp::profiling::add(pytomlpp::profiling::counter::bytes_out,
+                             text.size());
+  }
+
+  py::object source_path() const {
+    if (path.empty())
+      return py::none();
+    return py::reinterpret_borrow<py::object>(fsdecode)(py::bytes(path));
+  }
+};
+} // namespace
+
+namespace pytomlpp {
+void register_document(py::module &m) {
+  fsencode = py::module::import("os").attr("fsencode").release();
+  fsdecode = py::module::import("os").attr("fsdecode").release();
+
+  py::class_<document>(m, "Document")
+      .def(py::init(&document::from_text), py::arg("data") = py::str())
+      .def_static("load", &document::from_file, py::arg("path"))
+      .def("get", &document::get, py::arg("path"),
+           py::arg("default") = py::none())
+      .def("set", &document::set, py::arg("path"), py::arg("value"))
+      .def("delete", &document::remove, py::arg("path"))
+      .def("__getitem__", &document::get_item)
+      .def("__setitem__", &document::set)
+      .def("__delitem__", &document::remove)
+      .def("__contains__", &document::contains)
+      .def("save", &document::save, py::arg("path") = py::none())
+      .def("dumps", &document::dumps)
+      .def("to_dict", &document::to_dict)
+      .def_property_readonly("path", &document::source_path);
+}
+} // namespace pytomlpp
@@ -1,154 +1,452 @@
 #include <pytomlpp/pytomlpp.hpp>
+#include <pytomlpp/arena.hpp>
+#include <pytomlpp/locking.hpp>
+#include <pytomlpp/profiling.hpp>
 #include <pybind11/stl.h>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
 
 PYTOMLPP_PUSH_OPTIMIZATIONS;
 
 namespace pytomlpp {
-py::list toml_array_to_py_list(toml::array &&a) {
-  py::list result(a.size());
-  a.for_each([&](size_t index, auto &&val) {
-    if constexpr (toml::is_table<decltype(val)>)
-      result[index] = toml_table_to_py_dict(std::move(val));
-    else if constexpr (toml::is_array<decltype(val)>)
-      result[index] = toml_array_to_py_list(std::move(val));
-    else
-      result[index] = std::move(*val);
-  });
-  return result;
+namespace {
+py::handle array_class; // array.array
+
+py::dict new_dict(size_t size) {
+#if !defined(PYPY_VERSION) && PY_VERSION_HEX < 0x030D0000
+  // private, but exported up to 3.12; saves the rehashes of a growing dict
+  PyObject *dict = _PyDict_NewPresized(static_cast<Py_ssize_t>(size));
+#else
+  (void)size;
+  PyObject *dict = PyDict_New();
+#endif
+  if (!dict)
+    throw py::error_already_set();
+  return py::reinterpret_steal<py::dict>(dict);
+}
+
+// Scalars are created straight through the C API; only dates and times go
+// through their pybind11 casters, which own the datetime C API.
+template <typename Value> py::object scalar(Value &&val) {
+  using value_type =
+      typename std::remove_cv_t<std::remove_reference_t<Value>>::value_type;
+  PyObject *result;
+  if constexpr (std::is_same_v<value_type, std::string>)
+    result = PyUnicode_FromStringAndSize(val->data(),
+                                         static_cast<Py_ssize_t>(val->size()));
+  else if constexpr (std::is_same_v<value_type, int64_t>)
+    result = PyLong_FromLongLong(*val);
+  else if constexpr (std::is_same_v<value_type, double>)
+    result = PyFloat_FromDouble(*val);
+  else if constexpr (std::is_same_v<value_type, bool>)
+    return py::bool_(*val);
+  else
+    return py::cast(*val);
+  if (!result)
+    throw py::error_already_set();
+  return py::reinterpret_steal<py::object>(result);
 }
 
-py::dict toml_table_to_py_dict(toml::table &&t) {
-  py::dict result;
-  t.for_each([&](const toml::key &key, auto &&val) {
+// Converts toml trees to python objects. Containers are created at their final
+// size (toml++ knows it up front) and filled without intermediate temporaries.
+class toml_to_py_converter {
+  using key_map_allocator =
+      arena_allocator<std::pair<const std::string_view, py::object>>;
+
+  // Keys repeat a lot (every entry of an array of tables has the same ones),
+  // so each distinct key becomes one python string per conversion. They are
+  // not interned: interned strings are immortal on 3.12+, every key would leak.
+  // The views point into the keys of the tree being converted; the map's
+  // nodes live in the arena and are all dropped together at the end.
+  bump_arena arena;
+  std::unordered_map<std::string_view, py::object, std::hash<std::string_view>,
+                     std::equal_to<std::string_view>, key_map_allocator>
+      key_strings{0, std::hash<std::string_view>{},
+                  std::equal_to<std::string_view>{}, key_map_allocator{arena}};
+
+  py::handle key_string(const toml::key &key) {
+    auto [it, inserted] = key_strings.try_emplace(key.str());
+    if (inserted) {
+      PyObject *str = PyUnicode_FromStringAndSize(
+          key.str().data(), static_cast<Py_ssize_t>(key.str().size()));
+      if (!str) {
+        key_strings.erase(it);
+        throw py::error_already_set();
+      }
+      it->second = py::reinterpret_steal<py::object>(str);
+    }
+    return it->second;
+  }
+
+  bool numeric_buffers;
+
+  // array.array('q') or array.array('d') holding a homogeneous integer or
+  // float array, written in place through its buffer; null if the array is
+  // anything else
+  py::object numeric_buffer(const toml::array &a) {
+    const bool integers = a.is_homogeneous(toml::node_type::integer);
+    if (a.empty() ||
+        (!integers && !a.is_homogeneous(toml::node_type::floating_point)))
+      return {};
+    static_assert(sizeof(int64_t) == 8 && sizeof(double) == 8);
+    // a one element array repeated to the final length, so the values are
+    // not staged in an intermediate object that array.array would copy
+    const py::object element = py::reinterpret_borrow<py::object>(array_class)(
+        integers ? "q" : "d", py::make_tuple(0));
+    PyObject *buffer =
+        PySequence_Repeat(element.ptr(), static_cast<Py_ssize_t>(a.size()));
+    if (!buffer)
+      throw py::error_already_set();
+    auto result = py::reinterpret_steal<py::object>(buffer);
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(buffer, &view, PyBUF_WRITABLE) != 0)
+      throw py::error_already_set();
+    struct release_buffer {
+      Py_buffer *view;
+      ~release_buffer() { PyBuffer_Release(view); }
+    } release{&view};
+    char *data = static_cast<char *>(view.buf);
+    for (size_t i = 0; i < a.size(); i++, data += 8) {
+      if (integers) {
+        const int64_t v = a[i].as_integer()->get();
+        std::memcpy(data, &v, 8);
+      } else {
+        const double v = a[i].as_floating_point()->get();
+        std::memcpy(data, &v, 8);
+      }
+    }
+    profiling::add(profiling::counter::nodes_decoded, a.size());
+    return result;
+  }
+
+  template <typename Node> py::object value(Node &&val) {
     if constexpr (toml::is_table<decltype(val)>)
-      result[py::str(key.str())] = toml_table_to_py_dict(std::move(val));
-    else if constexpr (toml::is_array<decltype(val)>)
-      result[py::str(key.str())] = toml_array_to_py_list(std::move(val));
-    else
-      result[py::str(key.str())] = std::move(*val);
-  });
-  return result;
+      return table(val);
+    else if constexpr (toml::is_array<decltype(val)>) {
+      if (numeric_buffers) {
+        if (py::object buffer = numeric_buffer(val))
+          return buffer;
+      }
+      return array(val);
+    } else
+      return scalar(val);
+  }
+
+public:
+  explicit toml_to_py_converter(bool numeric_buffers = false) noexcept
+      : numeric_buffers{numeric_buffers} {}
+  toml_to_py_converter(const toml_to_py_converter &) = delete;
+  toml_to_py_converter &operator=(const toml_to_py_converter &) = delete;
+
+  template <typename Array> py::list array(Array &&a) {
+    PyObject *list = PyList_New(static_cast<Py_ssize_t>(a.size()));
+    if (!list)
+      throw py::error_already_set();
+    auto result = py::reinterpret_steal<py::list>(list);
+    a.for_each([&](size_t index, auto &&val) {
+      // the new list's slots are empty, so they can take the reference
+      PyList_SET_ITEM(list, static_cast<Py_ssize_t>(index),
+                      value(val).release().ptr());
+    });
+    profiling::add(profiling::counter::nodes_decoded, a.size());
+    return result;
+  }
+
+  template <typename Table> py::dict table(Table &&t) {
+    py::dict result = new_dict(t.size());
+    t.for_each([&](const toml::key &key, auto &&val) {
+      const py::object item = value(val);
+      if (PyDict_SetItem(result.ptr(), key_string(key).ptr(), item.ptr()))
+        throw py::error_already_set();
+    });
+    profiling::add(profiling::counter::nodes_decoded, t.size());
+    return result;
+  }
+
+  template <typename Node> py::object node(Node &&n) {
+    return n.visit([&](auto &&val) -> py::object { return value(val); });
+  }
+};
+
+// utf-8 contents of a python str, borrowed from the object itself so no
+// temporary bytes object or intermediate std::string is needed.
+std::string_view utf8_view(py::handle str) {
+  Py_ssize_t size = 0;
+  const char *data = PyUnicode_AsUTF8AndSize(str.ptr(), &size);
+  if (!data)
+    throw py::error_already_set();
+  return {data, static_cast<size_t>(size)};
 }
+} // namespace
 
-toml::array py_list_to_toml_array(const py::list &list) {
-  toml::array arr;
+py::list toml_array_to_py_list(toml::array &&a) {
+  return toml_to_py_converter{}.array(a);
+}
+
+py::dict toml_table_to_py_dict(toml::table &&t, bool numeric_buffers) {
+  return toml_to_py_converter{numeric_buffers}.table(t);
+}
+
+py::dict toml_table_to_py_dict(const toml::table &t) {
+  return toml_to_py_converter{}.table(t);
+}
+
+py::object toml_node_to_py(const toml::node &node) {
+  return toml_to_py_converter{}.node(node);
+}
+
+namespace {
+py::handle mapping_abc;
+py::handle sequence_abc;
+
+toml::table dict_to_toml_table(py::handle dict);
+toml::table mapping_to_toml_table(py::handle mapping);
+toml::array sequence_to_toml_array(py::handle sequence);
+
+int64_t to_int64(py::handle value) {
+  int overflow = 0;
+  const long long result = PyLong_AsLongLongAndOverflow(value.ptr(), &overflow);
+  if (overflow)
+    throw py::type_error(
+        py::str("integer {} does not fit in a toml integer").format(value));
+  if (result == -1 && PyErr_Occurred())
+    throw py::error_already_set();
+  return static_cast<int64_t>(result);
+}
+
+template <typename T> T read_item(const char *data) noexcept {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+// Converts a one-dimensional buffer of native integers, floats or bools
+// (array.array, numpy arrays, memoryviews...) without going through python
+// objects. Returns false, leaving out untouched, for any other object.
+bool buffer_to_toml_array(py::handle value, toml::array &out) {
+  PyObject *obj = value.ptr();
+  if (!PyObject_CheckBuffer(obj) || PyBytes_Check(obj) ||
+      PyByteArray_Check(obj))
+    return false;
+  Py_buffer view;
+  if (PyObject_GetBuffer(obj, &view, PyBUF_FORMAT | PyBUF_STRIDES) != 0) {
+    PyErr_Clear();
+    return false;
+  }
+  struct release_buffer {
+    Py_buffer *view;
+    ~release_buffer() { PyBuffer_Release(view); }
+  } release{&view};
 
-  auto PY_DATETIME_MODULE = py::module::import("datetime");
-  auto date_class = PY_DATETIME_MODULE.attr("date");
-  auto time_class = PY_DATETIME_MODULE.attr("time");
-  auto datetime_class = PY_DATETIME_MODULE.attr("datetime");
-
-  for (auto &&it : list) {
-    if (py::isinstance<py::str>(it)) {
-      std::string string_value = it.cast<py::str>();
-      arr.push_back(std::move(string_value));
-    } else if (py::isinstance<py::int_>(it)) {
-      int64_t int_value = it.cast<py::int_>();
-      arr.push_back(int_value);
-    } else if (py::isinstance<py::float_>(it)) {
-      double float_value = it.cast<py::float_>();
-      arr.push_back(float_value);
-    } else if (py::isinstance<py::bool_>(it)) {
-      bool bool_value = it.cast<py::bool_>();
-      arr.push_back(bool_value);
-    } else if (py::isinstance<py::dict>(it)) {
-      toml::table t = py_dict_to_toml_table(it.cast<py::dict>());
-      arr.push_back(std::move(t));
-    } else if (py::isinstance<py::list>(it)) {
-      toml::array a = py_list_to_toml_array(it.cast<py::list>());
-      arr.push_back(std::move(a));
-    } else if (py::isinstance(it, datetime_class)) {
-      // Order matters here.
-      // isinstance(datetime_obj, datetime) --> true
-      // isinstance(datetime_obj, date) --> true as well
-      // so we need to test datetime first then date.
-      toml::date_time date_time_value = it.cast<toml::date_time>();
-      arr.push_back(date_time_value);
-    } else if (py::isinstance(it, date_class)) {
-      toml::date date_value = it.cast<toml::date>();
-      arr.push_back(date_value);
-    } else if (py::isinstance(it, time_class)) {
-      toml::time time_value = it.cast<toml::time>();
-      arr.push_back(time_value);
+  const char *format = view.format ? view.format : "B";
+  if (*format == '@' || *format == '=')
+    format++;
+  if (view.ndim != 1 || !format[0] || format[1])
+    return false;
+  const char code = format[0];
+  const size_t size = static_cast<size_t>(view.itemsize);
+  const bool is_signed = std::strchr("bhilqn", code) != nullptr;
+  const bool is_unsigned = std::strchr("BHILQN", code) != nullptr;
+  const bool is_float = code == 'f' || code == 'd';
+  const bool is_bool = code == '?';
+  if (!(is_signed || is_unsigned || is_float || is_bool) ||
+      !(size == 1 || size == 2 || size == 4 || size == 8))
+    return false;
+
+  const auto count = static_cast<size_t>(view.shape[0]);
+  const char *data = static_cast<const char *>(view.buf);
+  out.reserve(count);
+  for (size_t i = 0; i < count; i++, data += view.strides[0]) {
+    if (is_bool) {
+      out.push_back(*data != 0);
+    } else if (is_float) {
+      out.push_back(size == 4 ? static_cast<double>(read_item<float>(data))
+                              : read_item<double>(data));
+    } else if (is_signed) {
+      out.push_back(size == 1   ? int64_t{read_item<int8_t>(data)}
+                    : size == 2 ? int64_t{read_item<int16_t>(data)}
+                    : size == 4 ? int64_t{read_item<int32_t>(data)}
+                                : read_item<int64_t>(data));
     } else {
-      throw py::type_error(
-          py::str("not a valid type for conversion {}").format(it));
+      const uint64_t v = size == 1   ? uint64_t{read_item<uint8_t>(data)}
+                         : size == 2 ? uint64_t{read_item<uint16_t>(data)}
+                         : size == 4 ? uint64_t{read_item<uint32_t>(data)}
+                                     : read_item<uint64_t>(data);
+      if (v > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+        throw py::type_error("integer " + std::to_string(v) +
+                             " does not fit in a toml integer");
+      out.push_back(static_cast<int64_t>(v));
     }
   }
-  return arr;
+  profiling::add(profiling::counter::nodes_encoded, out.size());
+  return true;
 }
 
-toml::table py_dict_to_toml_table(const py::dict &object) {
+[[noreturn]] void throw_unsupported(py::handle value) {
+  throw py::type_error(
+      py::str("cannot convert value {!r} to proper toml type").format(value));
+}
+
+// Converts a python value and hands the typed toml value to insert().
+// Exact builtin types are dispatched on Py_TYPE alone; subclasses and
+// abstract Mapping/Sequence implementations take the slower isinstance path.
+template <typename Insert>
+void convert_py_value(py::handle value, Insert &&insert) {
+  PyObject *obj = value.ptr();
+  PyTypeObject *type = Py_TYPE(obj);
+  const auto &types = py_datetime_types();
+
+  if (type == &PyBool_Type)
+    insert(obj == Py_True);
+  else if (type == &PyLong_Type)
+    insert(to_int64(value));
+  else if (type == &PyFloat_Type)
+    insert(PyFloat_AS_DOUBLE(obj));
+  else if (type == &PyUnicode_Type)
+    insert(std::string{utf8_view(value)});
+  else if (type == &PyDict_Type)
+    insert(dict_to_toml_table(value));
+  else if (type == &PyList_Type || type == &PyTuple_Type)
+    insert(sequence_to_toml_array(value));
+  else if (type == types.datetime)
+    insert(value.cast<toml::date_time>());
+  else if (type == types.date)
+    insert(value.cast<toml::date>());
+  else if (type == types.time)
+    insert(value.cast<toml::time>());
+  else if (PyLong_Check(obj))
+    insert(to_int64(value));
+  else if (PyFloat_Check(obj)) {
+    const double float_value = PyFloat_AsDouble(obj);
+    if (float_value == -1.0 && PyErr_Occurred())
+      throw py::error_already_set();
+    insert(float_value);
+  } else if (PyUnicode_Check(obj))
+    insert(std::string{utf8_view(value)});
+  else if (PyDict_Check(obj))
+    insert(dict_to_toml_table(value));
+  else if (PyList_Check(obj) || PyTuple_Check(obj))
+    insert(sequence_to_toml_array(value));
+  // Order matters here.
+  // isinstance(datetime_obj, datetime) --> true
+  // isinstance(datetime_obj, date) --> true as well
+  // so we need to test datetime first then date.
+  else if (PyObject_TypeCheck(obj, types.datetime))
+    insert(value.cast<toml::date_time>());
+  else if (PyObject_TypeCheck(obj, types.date))
+    insert(value.cast<toml::date>());
+  else if (PyObject_TypeCheck(obj, types.time))
+    insert(value.cast<toml::time>());
+  else if (toml::array arr; buffer_to_toml_array(value, arr))
+    insert(std::move(arr));
+  else if (py::isinstance(value, mapping_abc))
+    insert(mapping_to_toml_table(value));
+  else if (!PyBytes_Check(obj) && !PyByteArray_Check(obj) &&
+           py::isinstance(value, sequence_abc))
+    insert(sequence_to_toml_array(value));
+  else
+    throw_unsupported(value);
+}
+
+void insert_item(toml::table &t, py::handle key, py::handle value) {
+  if (!PyUnicode_Check(key.ptr()))
+    throw py::type_error("key must be a string...");
+  const std::string_view key_string = utf8_view(key);
+  convert_py_value(value, [&](auto &&toml_value) {
+    using value_type = decltype(toml_value);
+    t.insert_or_assign(key_string, std::forward<value_type>(toml_value));
+  });
+}
+
+toml::table dict_to_toml_table(py::handle dict) {
   toml::table t;
+  Py_ssize_t pos = 0;
+  PyObject *key = nullptr;
+  PyObject *value = nullptr;
+  // without the GIL another thread could drop key or value between
+  // PyDict_Next and the increfs below
+  critical_section section{dict};
+  while (PyDict_Next(dict.ptr(), &pos, &key, &value)) {
+    // keep both alive in case converting the value runs python code
+    auto key_ref = py::reinterpret_borrow<py::object>(key);
+    auto value_ref = py::reinterpret_borrow<py::object>(value);
+    insert_item(t, key_ref, value_ref);
+  }
+  profiling::add(profiling::counter::nodes_encoded, t.size());
+  return t;
+}
 
-  auto PY_DATETIME_MODULE = py::module::import("datetime");
-  auto date_class = PY_DATETIME_MODULE.attr("date");
-  auto time_class = PY_DATETIME_MODULE.attr("time");
-  auto datetime_class = PY_DATETIME_MODULE.attr("datetime");
-
-  for (auto &&it : object) {
-    auto key = it.first;
-    auto value = it.second;
-
-    if (!py::isinstance<py::str>(key))
-      throw py::type_error("key must be a string...");
-
-    std::string key_string = std::string(py::str(key));
-    bool insert_ok = true;
-    if (py::isinstance<py::bool_>(value)) {
-      bool bool_value = value.cast<py::bool_>();
-      auto insert = t.insert_or_assign(std::move(key_string), bool_value);
-      insert_ok = insert.second;
-    } else if (py::isinstance<py::int_>(value)) {
-      int64_t int_value = value.cast<py::int_>();
-      auto insert = t.insert_or_assign(std::move(key_string), int_value);
-      insert_ok = insert.second;
-    } else if (py::isinstance<py::float_>(value)) {
-      double float_value = value.cast<py::float_>();
-      auto insert = t.insert_or_assign(std::move(key_string), float_value);
-      insert_ok = insert.second;
-    } else if (py::isinstance<py::str>(value)) {
-      std::string string_value = value.cast<py::str>();
-      auto insert = t.insert_or_assign(std::move(key_string), string_value);
-      insert_ok = insert.second;
-    } else if (py::isinstance<py::dict>(value)) {
-      toml::table table_value = py_dict_to_toml_table(value.cast<py::dict>());
-      auto insert =
-          t.insert_or_assign(std::move(key_string), std::move(table_value));
-      insert_ok = insert.second;
-    } else if (py::isinstance<py::list>(value)) {
-      toml::array array_value = py_list_to_toml_array(value.cast<py::list>());
-      auto insert =
-          t.insert_or_assign(std::move(key_string), std::move(array_value));
-      insert_ok = insert.second;
-    } else if (py::isinstance(value, datetime_class)) {
-      // Order matters here.
-      // isinstance(datetime_obj, datetime) --> true
-      // isinstance(datetime_obj, date) --> true as well
-      // so we need to test datetime first then date.
-      toml::date_time date_time_value = value.cast<toml::date_time>();
-      auto insert = t.insert_or_assign(std::move(key_string), date_time_value);
-      insert_ok = insert.second;
-    } else if (py::isinstance(value, date_class)) {
-      toml::date date_value = value.cast<toml::date>();
-      auto insert = t.insert_or_assign(std::move(key_string), date_value);
-      insert_ok = insert.second;
-    } else if (py::isinstance(value, time_class)) {
-      toml::time time_value = value.cast<toml::time>();
-      auto insert = t.insert_or_assign(std::move(key_string), time_value);
-      insert_ok = insert.second;
-    } else {
-      std::stringstream ss;
-      ss << "cannot convert value " << value << " to proper toml type"
-         << std::endl;
-      throw py::type_error(ss.str());
-    }
-    if (!insert_ok) {
-      std::stringstream ss;
-      ss << "cannot insert key value pair:" << key << "," << value << std::endl;
-      throw py::type_error(ss.str());
-    }
+toml::table mapping_to_toml_table(py::handle mapping) {
+  toml::table t;
+  for (auto &&item : mapping.attr("items")()) {
+    auto pair = py::reinterpret_borrow<py::tuple>(item);
+    py::object key = pair[0];
+    py::object value = pair[1];
+    insert_item(t, key, value);
   }
+  profiling::add(profiling::counter::nodes_encoded, t.size());
   return t;
 }
+
+toml::array sequence_to_toml_array(py::handle sequence) {
+  toml::array arr;
+  auto push_back = [&](auto &&toml_value) {
+    arr.push_back(std::forward<decltype(toml_value)>(toml_value));
+  };
+
+  if (PyList_Check(sequence.ptr()) || PyTuple_Check(sequence.ptr())) {
+    auto fast = py::reinterpret_steal<py::object>(
+        PySequence_Fast(sequence.ptr(), "expected a list or tuple"));
+    if (!fast)
+      throw py::error_already_set();
+    // a list can be changed by other threads without the GIL
+    critical_section section{fast};
+    arr.reserve(static_cast<size_t>(PySequence_Fast_GET_SIZE(fast.ptr())));
+    // re-read the size every iteration, the list may shrink under us
+    for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(fast.ptr()); i++) {
+      auto item = py::reinterpret_borrow<py::object>(
+          PySequence_Fast_GET_ITEM(fast.ptr(), i));
+      convert_py_value(item, push_back);
+    }
+  } else {
+    for (auto &&item : sequence)
+      convert_py_value(item, push_back);
+  }
+  profiling::add(profiling::counter::nodes_encoded, arr.size());
+  return arr;
+}
+} // namespace
+
+void import_abc_types() {
+  auto collections_abc = py::module::import("collections.abc");
+  mapping_abc = collections_abc.attr("Mapping").release();
+  sequence_abc = collections_abc.attr("Sequence").release();
+  array_class = py::module::import("array").attr("array").release();
+}
+
+toml::array py_list_to_toml_array(const py::list &list) {
+  return sequence_to_toml_array(list);
+}
+
+toml::table py_dict_to_toml_table(const py::dict &object) {
+  return dict_to_toml_table(object);
+}
+
+void insert_py_value(toml::table &t, std::string_view key, py::handle value) {
+  convert_py_value(value, [&](auto &&toml_value) {
+    t.insert_or_assign(key, std::forward<decltype(toml_value)>(toml_value));
+  });
+}
+
+toml::table py_mapping_to_toml_table(py::handle object) {
+  if (PyDict_Check(object.ptr()))
+    return dict_to_toml_table(object);
+  if (py::isinstance(object, mapping_abc))
+    return mapping_to_toml_table(object);
+  throw py::type_error(py::str("expected a dict or Mapping, got {}")
+                           .format(py::type::of(object)));
+}
 } // namespace pytomlpp
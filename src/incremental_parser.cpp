@@ -0,0 +1,93 @@
+#include <pytomlpp/pytomlpp.hpp>
+#include <pytomlpp/locking.hpp>
+#include <pytomlpp/profiling.hpp>
+
+PYTOMLPP_PUSH_OPTIMIZATIONS;
+
+namespace {
+// Accumulates a document fed in chunks (from a socket, pipe...) into one
+// native buffer and parses it on close(). A TOML document is only valid as a
+// whole (later headers may extend or clash with earlier tables), so nothing
+// is parsed before the end of the input is known.
+class incremental_parser {
+  std::mutex mutex; // guards buffer and closed
+  std::string buffer;
+  bool closed = false;
+
+  void check_open() const {
+    if (closed)
+      throw py::value_error("feed() or close() called on a closed parser");
+  }
+
+public:
+  explicit incremental_parser(size_t size_hint) { buffer.reserve(size_hint); }
+
+  // str, or any contiguous bytes-like object (bytes, bytearray, memoryview)
+  void feed(const py::handle &data) {
+    if (PyUnicode_Check(data.ptr())) {
+      const std::string_view text = pytomlpp::document_view(data);
+      auto lock = pytomlpp::lock_detached(mutex);
+      check_open();
+      buffer += text;
+      return;
+    }
+    Py_buffer view;
+    if (PyObject_GetBuffer(data.ptr(), &view, PyBUF_SIMPLE) != 0)
+      throw py::error_already_set();
+    struct release_buffer {
+      Py_buffer *view;
+      ~release_buffer() { PyBuffer_Release(view); }
+    } release{&view};
+    auto lock = pytomlpp::lock_detached(mutex);
+    check_open();
+    buffer.append(static_cast<const char *>(view.buf),
+                  static_cast<size_t>(view.len));
+  }
+
+  py::object close(bool lazy) {
+    PROFILE_SCOPE("incremental_parser.close");
+    // the input is not needed once parsed, release it before converting
+    std::string input;
+    {
+      auto lock = pytomlpp::lock_detached(mutex);
+      check_open();
+      closed = true;
+      input.swap(buffer);
+    }
+    pytomlpp::profiling::add(pytomlpp::profiling::counter::bytes_in,
+                             input.size());
+    toml::table table;
+    try {
+      py::gil_scoped_release release;
+      table = toml::parse(std::string_view{input});
+    } catch (const toml::parse_error &e) {
+      pytomlpp::throw_decode_error(e);
+    }
+    std::string{}.swap(input);
+    if (lazy)
+      return pytomlpp::make_lazy_table(
+          std::make_shared<const toml::table>(std::move(table)));
+    return pytomlpp::toml_table_to_py_dict(std::move(table));
+  }
+
+  size_t buffered() {
+    auto lock = pytomlpp::lock_detached(mutex);
+    return buffer.size();
+  }
+  bool is_closed() {
+    auto lock = pytomlpp::lock_detached(mutex);
+    return closed;
+  }
+};
+} // namespace
+
+namespace pytomlpp {
+void register_incremental_parser(py::module &m) {
+  py::class_<incremental_parser>(m, "IncrementalParser")
+      .def(py::init<size_t>(), py::arg("size_hint") = 0)
+      .def("feed", &incremental_parser::feed, py::arg("data"))
+      .def("close", &incremental_parser::close, py::arg("lazy") = false)
+      .def_property_readonly("buffered", &incremental_parser::buffered)
+      .def_property_readonly("closed", &incremental_parser::is_closed);
+}
+} // namespace pytomlpp
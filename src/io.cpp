@@ -0,0 +1,415 @@
+#include <pytomlpp/pytomlpp.hpp>
+#include <pytomlpp/io.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+PYTOMLPP_PUSH_OPTIMIZATIONS;
+
+namespace pytomlpp {
+namespace {
+// name of a temporary file next to target; the process id and a counter keep
+// writers apart, creating it exclusively catches any remaining clash
+std::string temporary_name(const std::string &target) {
+  static std::atomic<unsigned> counter{0};
+#ifdef _WIN32
+  const int pid = ::_getpid();
+#else
+  const int pid = static_cast<int>(::getpid());
+#endif
+  return target + ".tmp" + std::to_string(pid) + "." +
+         std::to_string(counter++);
+}
+} // namespace
+
+#ifdef _WIN32
+namespace {
+std::wstring widen(const std::string &path) {
+  if (path.empty())
+    return {};
+  const int length = MultiByteToWideChar(CP_UTF8, 0, path.data(),
+                                         static_cast<int>(path.size()),
+                                         nullptr, 0);
+  std::wstring wide(static_cast<size_t>(length), L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, path.data(), static_cast<int>(path.size()),
+                      wide.data(), length);
+  return wide;
+}
+
+std::string narrow(const std::wstring &wide) {
+  if (wide.empty())
+    return {};
+  const int length = WideCharToMultiByte(CP_UTF8, 0, wide.data(),
+                                         static_cast<int>(wide.size()), nullptr,
+                                         0, nullptr, nullptr);
+  std::string path(static_cast<size_t>(length), '\0');
+  WideCharToMultiByte(CP_UTF8, 0, wide.data(), static_cast<int>(wide.size()),
+                      path.data(), length, nullptr, nullptr);
+  return path;
+}
+} // namespace
+
+file_contents::file_contents(const std::string &path) noexcept {
+  const std::wstring wide_path = widen(path);
+  HANDLE file = CreateFileW(
+      wide_path.c_str(), GENERIC_READ,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    error_ = static_cast<int>(GetLastError());
+    return;
+  }
+
+  try {
+    // sized up front for disk files, one spare byte so the read reporting
+    // the end needs no growth; pipes and consoles grow as they are read
+    LARGE_INTEGER file_size;
+    size_t capacity = 64 * 1024;
+    if (GetFileType(file) == FILE_TYPE_DISK && GetFileSizeEx(file, &file_size))
+      capacity = static_cast<size_t>(file_size.QuadPart) + 1;
+    size_t size = 0;
+    for (;;) {
+      if (size == data_.size())
+        data_.resize(std::max(capacity, data_.size() * 2));
+      DWORD count = 0;
+      const DWORD wanted =
+          static_cast<DWORD>(std::min<size_t>(data_.size() - size, 1u << 30));
+      if (!ReadFile(file, &data_[size], wanted, &count, nullptr)) {
+        // a pipe whose write end was closed has simply ended
+        if (const DWORD last_error = GetLastError();
+            last_error != ERROR_BROKEN_PIPE)
+          error_ = static_cast<int>(last_error);
+        break;
+      }
+      if (count == 0)
+        break;
+      size += count;
+    }
+    data_.resize(size);
+  } catch (const std::bad_alloc &) {
+    error_ = ERROR_NOT_ENOUGH_MEMORY;
+  }
+  CloseHandle(file);
+}
+
+int stat_file(const std::string &path, file_stamp &stamp) noexcept {
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExW(widen(path).c_str(), GetFileExInfoStandard, &data))
+    return static_cast<int>(GetLastError());
+  if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+    return ERROR_DIRECTORY;
+  stamp.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) |
+               data.nFileSizeLow;
+  // 100ns intervals since 1601, only ever compared for equality
+  const uint64_t ticks =
+      (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+      data.ftLastWriteTime.dwLowDateTime;
+  stamp.mtime_ns = static_cast<int64_t>(ticks) * 100;
+  return 0;
+}
+
+void throw_os_error(int error_code, const std::string &path) {
+  PyErr_SetExcFromWindowsErrWithFilename(PyExc_OSError, error_code,
+                                         path.c_str());
+  throw py::error_already_set();
+}
+
+bool fd_sink::write_chunk(const char *data, size_t size) {
+  while (size > 0) {
+    const unsigned int count =
+        static_cast<unsigned int>(std::min<size_t>(size, 1u << 30));
+    const int written = ::_write(fd_, data, count);
+    if (written < 0) {
+      error_ = errno;
+      return false;
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+int open_for_writing(const std::string &path) noexcept {
+  return ::_wopen(widen(path).c_str(),
+                  _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY | _O_NOINHERIT,
+                  _S_IREAD | _S_IWRITE);
+}
+
+std::string resolve_symlinks(const std::string &path) {
+  HANDLE file = CreateFileW(
+      widen(path).c_str(), 0,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+      OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return path;
+  // a result not below the buffer size is the size needed, with the null
+  std::wstring resolved(MAX_PATH, L'\0');
+  DWORD length = GetFinalPathNameByHandleW(
+      file, resolved.data(), static_cast<DWORD>(resolved.size()),
+      FILE_NAME_NORMALIZED);
+  if (length >= resolved.size()) {
+    resolved.resize(length);
+    length = GetFinalPathNameByHandleW(file, resolved.data(),
+                                       static_cast<DWORD>(resolved.size()),
+                                       FILE_NAME_NORMALIZED);
+  }
+  CloseHandle(file);
+  if (length == 0 || length >= resolved.size())
+    return path;
+  resolved.resize(length);
+  return narrow(resolved);
+}
+
+int open_temporary(const std::string &target,
+                   std::string &temp_path) noexcept {
+  for (int attempt = 0; attempt < 100; attempt++) {
+    temp_path = temporary_name(target);
+    const int fd = ::_wopen(widen(temp_path).c_str(),
+                            _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY |
+                                _O_NOINHERIT,
+                            _S_IREAD | _S_IWRITE);
+    if (fd >= 0 || errno != EEXIST)
+      return fd;
+  }
+  return -1;
+}
+
+int sync_file(int fd) noexcept { return ::_commit(fd) == 0 ? 0 : errno; }
+
+int close_file(int fd) noexcept { return ::_close(fd) == 0 ? 0 : errno; }
+
+int replace_file(const std::string &path, const std::string &target) noexcept {
+  if (!MoveFileExW(widen(path).c_str(), widen(target).c_str(),
+                   MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    return static_cast<int>(GetLastError());
+  return 0;
+}
+
+void remove_file(const std::string &path) noexcept {
+  ::_wremove(widen(path).c_str());
+}
+#else
+file_contents::file_contents(const std::string &path) noexcept {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    error_ = errno;
+    return;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    error_ = errno;
+  } else if (S_ISDIR(st.st_mode)) {
+    error_ = EISDIR;
+  } else {
+    try {
+      // sized up front for regular files, one spare byte so the read
+      // reporting the end needs no growth; the loop also copes with files
+      // changing size meanwhile and with pipes
+      const size_t capacity = S_ISREG(st.st_mode)
+                                  ? static_cast<size_t>(st.st_size) + 1
+                                  : 64 * 1024;
+      size_t size = 0;
+      for (;;) {
+        if (size == data_.size())
+          data_.resize(std::max(capacity, data_.size() * 2));
+        const ssize_t count = ::read(fd, &data_[size], data_.size() - size);
+        if (count > 0)
+          size += static_cast<size_t>(count);
+        else if (count == 0)
+          break;
+        else if (errno != EINTR) {
+          error_ = errno;
+          break;
+        }
+      }
+      data_.resize(size);
+    } catch (const std::bad_alloc &) {
+      error_ = ENOMEM;
+    }
+  }
+  ::close(fd);
+}
+
+int stat_file(const std::string &path, file_stamp &stamp) noexcept {
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0)
+    return errno;
+  if (S_ISDIR(st.st_mode))
+    return EISDIR;
+  stamp.size = static_cast<uint64_t>(st.st_size);
+#ifdef __APPLE__
+  const struct timespec &mtime = st.st_mtimespec;
+#else
+  const struct timespec &mtime = st.st_mtim;
+#endif
+  stamp.mtime_ns = static_cast<int64_t>(mtime.tv_sec) * 1000000000 +
+                   static_cast<int64_t>(mtime.tv_nsec);
+  return 0;
+}
+
+void throw_os_error(int error_code, const std::string &path) {
+  throw_errno_error(error_code, path);
+}
+
+bool fd_sink::write_chunk(const char *data, size_t size) {
+  while (size > 0) {
+    const ssize_t written = ::write(fd_, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      error_ = errno;
+      return false;
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+int open_for_writing(const std::string &path) noexcept {
+  return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+}
+
+std::string resolve_symlinks(const std::string &path) {
+  char *resolved = ::realpath(path.c_str(), nullptr);
+  if (!resolved)
+    return path;
+  std::string result{resolved};
+  std::free(resolved);
+  return result;
+}
+
+int open_temporary(const std::string &target,
+                   std::string &temp_path) noexcept {
+  // the replacement keeps the permission bits of the file it replaces
+  struct stat st;
+  const bool replacing = ::stat(target.c_str(), &st) == 0;
+  for (int attempt = 0; attempt < 100; attempt++) {
+    temp_path = temporary_name(target);
+    const int fd = ::open(temp_path.c_str(),
+                          O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    // unlike the mode given to open(), this is not masked by the umask
+    if (fd >= 0 && replacing)
+      ::fchmod(fd, st.st_mode & 07777);
+    if (fd >= 0 || errno != EEXIST)
+      return fd;
+  }
+  return -1;
+}
+
+int sync_file(int fd) noexcept {
+  while (::fsync(fd) != 0) {
+    if (errno != EINTR)
+      return errno;
+  }
+  return 0;
+}
+
+int close_file(int fd) noexcept { return ::close(fd) == 0 ? 0 : errno; }
+
+int replace_file(const std::string &path, const std::string &target) noexcept {
+  return ::rename(path.c_str(), target.c_str()) == 0 ? 0 : errno;
+}
+
+void remove_file(const std::string &path) noexcept { ::unlink(path.c_str()); }
+#endif
+
+void throw_errno_error(int error_code, const std::string &path) {
+  errno = error_code;
+  if (path.empty())
+    PyErr_SetFromErrno(PyExc_OSError);
+  else
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path.c_str());
+  throw py::error_already_set();
+}
+
+output_sink::output_sink(size_t capacity)
+    : buffer_{new char[capacity]}, capacity_{capacity} {
+  setp(buffer_.get(), buffer_.get() + capacity_);
+}
+
+bool output_sink::flush_buffer() {
+  const size_t pending = static_cast<size_t>(pptr() - pbase());
+  if (pending && !failed_) {
+    if (write_chunk(pbase(), pending))
+      bytes_written_ += pending;
+    else
+      failed_ = true;
+  }
+  setp(buffer_.get(), buffer_.get() + capacity_);
+  return !failed_;
+}
+
+output_sink::int_type output_sink::overflow(int_type ch) {
+  if (!flush_buffer())
+    return traits_type::eof();
+  if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+  }
+  return traits_type::not_eof(ch);
+}
+
+std::streamsize output_sink::xsputn(const char *data, std::streamsize size) {
+  const size_t count = static_cast<size_t>(size);
+  if (count > static_cast<size_t>(epptr() - pptr())) {
+    if (!flush_buffer())
+      return 0;
+    // too big to be worth buffering, write it through
+    if (count >= capacity_) {
+      if (!write_chunk(data, count)) {
+        failed_ = true;
+        return 0;
+      }
+      bytes_written_ += count;
+      return size;
+    }
+  }
+  std::memcpy(pptr(), data, count);
+  pbump(static_cast<int>(count));
+  return size;
+}
+
+int output_sink::sync() { return flush_buffer() ? 0 : -1; }
+
+bool output_sink::finish() { return flush_buffer(); }
+
+string_sink::int_type string_sink::overflow(int_type ch) {
+  if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+    out_.push_back(traits_type::to_char_type(ch));
+    if (hash_)
+      hash_->update({&out_.back(), 1});
+  }
+  return traits_type::not_eof(ch);
+}
+
+std::streamsize string_sink::xsputn(const char *data, std::streamsize size) {
+  out_.append(data, static_cast<size_t>(size));
+  if (hash_)
+    hash_->update({data, static_cast<size_t>(size)});
+  return size;
+}
+} // namespace pytomlpp
@@ -0,0 +1,434 @@
+#include <pytomlpp/pytomlpp.hpp>
+#include <pytomlpp/io.hpp>
+#include <pytomlpp/profiling.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+PYTOMLPP_PUSH_OPTIMIZATIONS;
+
+namespace {
+struct json_error {
+  const char *message;
+  size_t offset;
+};
+
+// Recursive descent parser from RFC 8259 JSON straight into toml++ nodes.
+// The document must be an object and null, which has no TOML equivalent, is
+// rejected. Integers beyond int64 are deliberately converted to floats, and
+// duplicate keys keep the last value.
+class json_parser {
+  static constexpr size_t max_depth = 512;
+
+  std::string_view text;
+  size_t pos = 0;
+  size_t depth = 0;
+  // reused for every float; imbued with the classic locale, as strtod would
+  // follow the C locale's decimal point
+  std::istringstream float_stream;
+
+  [[noreturn]] void fail(const char *message) const {
+    throw json_error{message, pos};
+  }
+
+  void skip_whitespace() noexcept {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' ||
+                                 text[pos] == '\r' || text[pos] == '\t'))
+      pos++;
+  }
+
+  bool consume(char c) noexcept {
+    skip_whitespace();
+    if (pos < text.size() && text[pos] == c) {
+      pos++;
+      return true;
+    }
+    return false;
+  }
+
+  void expect(char c, const char *message) {
+    if (!consume(c))
+      fail(message);
+  }
+
+  void enter() {
+    if (++depth > max_depth)
+      fail("nested too deeply");
+  }
+
+  template <typename Insert> void value(Insert &&insert) {
+    skip_whitespace();
+    if (pos >= text.size())
+      fail("unexpected end of input");
+    switch (text[pos]) {
+    case '{':
+      pos++;
+      insert(object());
+      break;
+    case '[':
+      pos++;
+      insert(array());
+      break;
+    case '"':
+      pos++;
+      insert(string());
+      break;
+    case 't':
+      literal("true");
+      insert(true);
+      break;
+    case 'f':
+      literal("false");
+      insert(false);
+      break;
+    case 'n':
+      fail("null has no TOML equivalent");
+    default:
+      number(insert);
+    }
+  }
+
+  void literal(std::string_view word) {
+    if (text.substr(pos, word.size()) != word)
+      fail("invalid literal");
+    pos += word.size();
+  }
+
+  toml::table object() {
+    enter();
+    toml::table t;
+    if (!consume('}')) {
+      do {
+        skip_whitespace();
+        if (pos >= text.size() || text[pos] != '"')
+          fail("expected a string key");
+        pos++;
+        const std::string key = string();
+        expect(':', "expected ':' after an object key");
+        value([&](auto &&val) {
+          t.insert_or_assign(key, std::forward<decltype(val)>(val));
+        });
+      } while (consume(','));
+      expect('}', "expected ',' or '}' in an object");
+    }
+    depth--;
+    return t;
+  }
+
+  toml::array array() {
+    enter();
+    toml::array arr;
+    if (!consume(']')) {
+      do {
+        value([&](auto &&val) {
+          arr.push_back(std::forward<decltype(val)>(val));
+        });
+      } while (consume(','));
+      expect(']', "expected ',' or ']' in an array");
+    }
+    depth--;
+    return arr;
+  }
+
+  uint32_t hex4() {
+    if (text.size() - pos < 4)
+      fail("truncated \\u escape");
+    uint32_t value = 0;
+    for (size_t end = pos + 4; pos < end; pos++) {
+      const char c = text[pos];
+      value <<= 4;
+      if (c >= '0' && c <= '9')
+        value |= static_cast<uint32_t>(c - '0');
+      else if (c >= 'a' && c <= 'f')
+        value |= static_cast<uint32_t>(c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F')
+        value |= static_cast<uint32_t>(c - 'A' + 10);
+      else
+        fail("invalid \\u escape");
+    }
+    return value;
+  }
+
+  static void append_utf8(std::string &out, uint32_t cp) {
+    if (cp < 0x80) {
+      out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+      out += static_cast<char>(0xC0 | (cp >> 6));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+      out += static_cast<char>(0xE0 | (cp >> 12));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+      out += static_cast<char>(0xF0 | (cp >> 18));
+      out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+  }
+
+  // after the opening quote, consumes the closing one
+  std::string string() {
+    std::string out;
+    for (;;) {
+      const size_t start = pos;
+      while (pos < text.size() && text[pos] != '"' && text[pos] != '\\' &&
+             static_cast<unsigned char>(text[pos]) >= 0x20)
+        pos++;
+      out.append(text.data() + start, pos - start);
+      if (pos >= text.size())
+        fail("unterminated string");
+      const char c = text[pos++];
+      if (c == '"')
+        return out;
+      if (c != '\\') {
+        pos--;
+        fail("control character in string");
+      }
+      if (pos >= text.size())
+        fail("unterminated string");
+      switch (text[pos++]) {
+      case '"':
+        out += '"';
+        break;
+      case '\\':
+        out += '\\';
+        break;
+      case '/':
+        out += '/';
+        break;
+      case 'b':
+        out += '\b';
+        break;
+      case 'f':
+        out += '\f';
+        break;
+      case 'n':
+        out += '\n';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case 't':
+        out += '\t';
+        break;
+      case 'u': {
+        uint32_t cp = hex4();
+        if (cp >= 0xDC00 && cp <= 0xDFFF)
+          fail("lone low surrogate in \\u escape");
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+          if (text.substr(pos, 2) != "\\u")
+            fail("lone high surrogate in \\u escape");
+          pos += 2;
+          const uint32_t low = hex4();
+          if (low < 0xDC00 || low > 0xDFFF)
+            fail("invalid low surrogate in \\u escape");
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+        append_utf8(out, cp);
+        break;
+      }
+      default:
+        pos--;
+        fail("invalid escape in string");
+      }
+    }
+  }
+
+  template <typename Insert> void number(Insert &&insert) {
+    const size_t start = pos;
+    const bool negative = pos < text.size() && text[pos] == '-';
+    if (negative)
+      pos++;
+    auto digits = [&]() {
+      const size_t first = pos;
+      while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+        pos++;
+      return pos - first;
+    };
+
+    const size_t int_start = pos;
+    const size_t int_digits = digits();
+    if (int_digits == 0)
+      fail(negative ? "expected digits after '-'" : "unexpected character");
+    if (int_digits > 1 && text[int_start] == '0')
+      fail("leading zeros are not allowed");
+    bool integer = true;
+    if (pos < text.size() && text[pos] == '.') {
+      pos++;
+      integer = false;
+      if (!digits())
+        fail("expected digits after '.'");
+    }
+    if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+      pos++;
+      integer = false;
+      if (pos < text.size() && (text[pos] == '+' || text[pos] == '-'))
+        pos++;
+      if (!digits())
+        fail("expected digits in the exponent");
+    }
+
+    if (integer) {
+      // accumulate the magnitude, falling back to a float on overflow
+      const uint64_t limit =
+          static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) +
+          (negative ? 1 : 0);
+      uint64_t magnitude = 0;
+      bool overflow = false;
+      for (size_t i = int_start; i < pos && !overflow; i++) {
+        const auto digit = static_cast<uint64_t>(text[i] - '0');
+        overflow = magnitude > (limit - digit) / 10;
+        magnitude = magnitude * 10 + digit;
+      }
+      if (!overflow) {
+        insert(negative ? static_cast<int64_t>(0 - magnitude)
+                        : static_cast<int64_t>(magnitude));
+        return;
+      }
+    }
+    float_stream.clear();
+    float_stream.str(std::string{text.substr(start, pos - start)});
+    double value = 0.0;
+    float_stream >> value;
+    // on overflow the stream stores the largest finite value, json.loads
+    // gives an infinity; underflow already yields 0 or a subnormal
+    if (float_stream.fail() && std::abs(value) >= 1.0)
+      value = std::copysign(std::numeric_limits<double>::infinity(), value);
+    insert(value);
+  }
+
+public:
+  explicit json_parser(std::string_view text) : text{text} {
+    float_stream.imbue(std::locale::classic());
+  }
+
+  toml::table parse() {
+    if (!consume('{'))
+      fail("expected an object at the top level");
+    toml::table t = object();
+    skip_whitespace();
+    if (pos != text.size())
+      fail("unexpected data after the top-level object");
+    return t;
+  }
+};
+
+[[noreturn]] void throw_json_error(const json_error &e, std::string_view text,
+                                   const std::string &path) {
+  const std::string_view before = text.substr(0, e.offset);
+  const size_t line = static_cast<size_t>(
+      std::count(before.begin(), before.end(), '\n') + 1);
+  const size_t line_start = before.rfind('\n');
+  const size_t column =
+      e.offset - (line_start == std::string_view::npos ? 0 : line_start + 1) +
+      1;
+  std::ostringstream message;
+  message << "invalid JSON";
+  if (!path.empty())
+    message << " in " << path;
+  message << ": " << e.message << " (line " << line << ", column " << column
+          << ")";
+  throw py::value_error(message.str());
+}
+
+std::string format_json(const toml::table &t) {
+  std::string out;
+  pytomlpp::string_sink sink{out};
+  std::ostream os{&sink};
+  os << toml::json_formatter{t};
+  return out;
+}
+
+std::string format_toml(const toml::table &t) {
+  std::string out;
+  pytomlpp::string_sink sink{out};
+  std::ostream os{&sink};
+  os << t;
+  return out;
+}
+
+py::bytes toml_to_json(const py::object &document) {
+  PROFILE_SCOPE("toml_to_json.total");
+  const std::string_view text = pytomlpp::document_view(document);
+  pytomlpp::profiling::add(pytomlpp::profiling::counter::bytes_in,
+                           text.size());
+  std::string out;
+  try {
+    py::gil_scoped_release release;
+    out = format_json(toml::parse(text));
+  } catch (const toml::parse_error &e) {
+    pytomlpp::throw_decode_error(e);
+  }
+  return py::bytes(out);
+}
+
+py::bytes toml_file_to_json(const std::string &path) {
+  PROFILE_SCOPE("toml_file_to_json.total");
+  std::string out;
+  int error_code = 0;
+  try {
+    py::gil_scoped_release release;
+    pytomlpp::file_contents file{path};
+    error_code = file.error();
+    if (!error_code) {
+      pytomlpp::profiling::add(pytomlpp::profiling::counter::bytes_in,
+                               file.view().size());
+      out = format_json(toml::parse(file.view(), std::string_view{path}));
+    }
+  } catch (const toml::parse_error &e) {
+    pytomlpp::throw_decode_error(e);
+  }
+  if (error_code)
+    pytomlpp::throw_os_error(error_code, path);
+  return py::bytes(out);
+}
+
+std::string json_to_toml(const py::object &document) {
+  PROFILE_SCOPE("json_to_toml.total");
+  const std::string_view text = pytomlpp::document_view(document);
+  std::string out;
+  try {
+    py::gil_scoped_release release;
+    out = format_toml(json_parser{text}.parse());
+  } catch (const json_error &e) {
+    throw_json_error(e, text, {});
+  }
+  pytomlpp::profiling::add(pytomlpp::profiling::counter::bytes_out,
+                           out.size());
+  return out;
+}
+
+std::string json_file_to_toml(const std::string &path) {
+  PROFILE_SCOPE("json_file_to_toml.total");
+  // the mapping has to outlive a json_error, which points into it
+  std::string out;
+  int error_code = 0;
+  std::unique_ptr<pytomlpp::file_contents> file;
+  try {
+    py::gil_scoped_release release;
+    file = std::make_unique<pytomlpp::file_contents>(path);
+    error_code = file->error();
+    if (!error_code)
+      out = format_toml(json_parser{file->view()}.parse());
+  } catch (const json_error &e) {
+    throw_json_error(e, file->view(), path);
+  }
+  if (error_code)
+    pytomlpp::throw_os_error(error_code, path);
+  pytomlpp::profiling::add(pytomlpp::profiling::counter::bytes_out,
+                           out.size());
+  return out;
+}
+} // namespace
+
+namespace pytomlpp {
+void register_json(py::module &m) {
+  m.def("toml_to_json", &toml_to_json, py::arg("data"));
+  m.def("toml_file_to_json", &toml_file_to_json, py::arg("path"));
+  m.def("json_to_toml", &json_to_toml, py::arg("data"));
+  m.def("json_file_to_toml", &json_file_to_toml, py::arg("path"));
+}
+} // namespace pytomlpp
@@ -0,0 +1,121 @@
+#include <pytomlpp/pytomlpp.hpp>
+
+PYTOMLPP_PUSH_OPTIMIZATIONS;
+
+namespace {
+using root_ptr = std::shared_ptr<const toml::table>;
+
+py::handle keys_view_type;
+py::handle values_view_type;
+py::handle items_view_type;
+
+// Every proxy keeps the whole parsed document alive through root, so nodes
+// handed out for sub-tables stay valid for as long as any proxy exists.
+class lazy_table {
+  root_ptr root;
+  const toml::table *table;
+  py::dict cache;
+
+public:
+  lazy_table(root_ptr root, const toml::table &table)
+      : root{std::move(root)}, table{&table} {}
+
+  py::object getitem(const py::object &key) {
+    if (PyObject *cached = PyDict_GetItemWithError(cache.ptr(), key.ptr()))
+      return py::reinterpret_borrow<py::object>(cached);
+    if (PyErr_Occurred())
+      throw py::error_already_set();
+    const toml::node *node = nullptr;
+    if (py::isinstance<py::str>(key))
+      node = table->get(key.cast<std::string_view>());
+    if (!node) {
+      PyErr_SetObject(PyExc_KeyError, key.ptr());
+      throw py::error_already_set();
+    }
+    // arrays become a fresh list on every access: a cached one would let a
+    // caller's append() show through later lookups of this read-only view
+    py::object value = convert(*node);
+    if (node->is_array())
+      return value;
+    // threads racing on the same key all get the value stored first
+    PyObject *stored = PyDict_SetDefault(cache.ptr(), key.ptr(), value.ptr());
+    if (!stored)
+      throw py::error_already_set();
+    return py::reinterpret_borrow<py::object>(stored);
+  }
+
+  py::object get(const py::object &key, const py::object &default_value) {
+    if (!contains(key))
+      return default_value;
+    return getitem(key);
+  }
+
+  bool contains(const py::object &key) const {
+    return py::isinstance<py::str>(key) &&
+           table->contains(key.cast<std::string_view>());
+  }
+
+  size_t size() const noexcept { return table->size(); }
+
+  py::list keys() const {
+    py::list result(table->size());
+    size_t index = 0;
+    for (auto &&kvp : *table)
+      result[index++] = py::str(kvp.first.str());
+    return result;
+  }
+
+  py::dict to_dict() const { return pytomlpp::toml_table_to_py_dict(*table); }
+
+  py::object convert(const toml::node &node) const {
+    return node.visit([&](auto &&val) -> py::object {
+      if constexpr (toml::is_table<decltype(val)>)
+        return py::cast(lazy_table{root, val});
+      else if constexpr (toml::is_array<decltype(val)>) {
+        py::list result(val.size());
+        for (size_t i = 0; i < val.size(); i++)
+          result[i] = convert(val[i]);
+        return std::move(result);
+      } else
+        return py::cast(*val);
+    });
+  }
+};
+} // namespace
+
+namespace pytomlpp {
+py::object make_lazy_table(std::shared_ptr<const toml::table> root) {
+  const toml::table &table = *root;
+  return py::cast(lazy_table{std::move(root), table});
+}
+
+void register_lazy_table(py::module &m) {
+  auto collections_abc = py::module::import("collections.abc");
+  keys_view_type = collections_abc.attr("KeysView").release();
+  values_view_type = collections_abc.attr("ValuesView").release();
+  items_view_type = collections_abc.attr("ItemsView").release();
+
+  py::class_<lazy_table>(m, "TomlTable")
+      .def("__getitem__", &lazy_table::getitem)
+      .def("__contains__", &lazy_table::contains)
+      .def("__len__", &lazy_table::size)
+      .def("__iter__",
+           [](const lazy_table &self) { return py::iter(self.keys()); })
+      .def("get", &lazy_table::get, py::arg("key"),
+           py::arg("default") = py::none())
+      .def("keys",
+           [](py::object self) { return keys_view_type(std::move(self)); })
+      .def("values",
+           [](py::object self) { return values_view_type(std::move(self)); })
+      .def("items",
+           [](py::object self) { return items_view_type(std::move(self)); })
+      .def("to_dict", &lazy_table::to_dict)
+      .def("__eq__",
+           [](py::object self, const py::object &other) {
+             return py::dict(std::move(self)).equal(other);
+           })
+      .def("__repr__", [](py::object self) {
+        return "TomlTable(" + std::string(py::repr(py::dict(self))) + ")";
+      });
+}
+} // namespace pytomlpp
@@ -0,0 +1,163 @@
+#include <pytomlpp/pytomlpp.hpp>
+#include <pytomlpp/profiling.hpp>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+PYTOMLPP_PUSH_OPTIMIZATIONS;
+
+namespace pytomlpp::profiling {
+std::atomic<bool> enabled{PYTOMLPP_PROFILING != 0};
+std::atomic<uint64_t> counters[static_cast<size_t>(counter::count_)] = {};
+
+namespace {
+constexpr const char *counter_names[] = {"bytes_in", "bytes_out",
+                                         "nodes_decoded", "nodes_encoded"};
+static_assert(std::size(counter_names) ==
+              static_cast<size_t>(counter::count_));
+
+std::mutex phases_mutex;
+std::deque<phase_stats> phases; // deque: elements never move
+
+// the lock is not held while the caller works with the phases, so creating
+// python objects (which may run arbitrary code) cannot deadlock against a
+// thread registering a phase
+std::vector<phase_stats *> registered_phases() {
+  std::lock_guard<std::mutex> lock{phases_mutex};
+  std::vector<phase_stats *> result;
+  result.reserve(phases.size());
+  for (auto &phase : phases)
+    result.push_back(&phase);
+  return result;
+}
+
+py::dict phase_to_dict(const phase_stats &phase) {
+  const auto count = phase.count.load(std::memory_order_relaxed);
+  const auto total_ns = phase.total_ns.load(std::memory_order_relaxed);
+  py::dict histogram;
+  for (size_t i = 0; i < histogram_buckets; i++) {
+    if (auto hits = phase.histogram[i].load(std::memory_order_relaxed))
+      histogram[py::int_(uint64_t{1} << i)] = hits;
+  }
+
+  py::dict result;
+  result["count"] = count;
+  result["total_ns"] = total_ns;
+  result["min_ns"] = phase.min_ns.load(std::memory_order_relaxed);
+  result["max_ns"] = phase.max_ns.load(std::memory_order_relaxed);
+  result["mean_ns"] = count ? total_ns / count : 0;
+  result["histogram"] = std::move(histogram);
+  return result;
+}
+
+py::dict get_stats() {
+  py::dict phase_dicts;
+  for (const auto *phase : registered_phases()) {
+    if (phase->count.load(std::memory_order_relaxed))
+      phase_dicts[phase->name] = phase_to_dict(*phase);
+  }
+
+  py::dict counter_dict;
+  for (size_t i = 0; i < std::size(counter_names); i++)
+    counter_dict[counter_names[i]] =
+        counters[i].load(std::memory_order_relaxed);
+
+  py::dict result;
+  result["enabled"] = is_enabled();
+  result["phases"] = std::move(phase_dicts);
+  result["counters"] = std::move(counter_dict);
+  return result;
+}
+
+void reset_stats() {
+  for (auto *phase : registered_phases())
+    phase->reset();
+  for (auto &value : counters)
+    value.store(0, std::memory_order_relaxed);
+}
+
+#if PYTOMLPP_PROFILING
+void print_stats() {
+  py::print("\npytomlpp profiling summary:\n-----------------------------");
+  std::ostringstream oss;
+  for (const auto *phase : registered_phases()) {
+    const auto count = phase->count.load(std::memory_order_relaxed);
+    if (!count)
+      continue;
+    const auto total_ns = phase->total_ns.load(std::memory_order_relaxed);
+    oss << std::setw(22) << phase->name << ":  counter = " << std::setw(7)
+        << count << ", total_time_in_ns = " << std::setw(12) << total_ns
+        << ", average_time_in_ns = " << std::setw(7) << total_ns / count
+        << "\n";
+  }
+  const auto summary = oss.str();
+  py::print(summary.empty() ? "no profiling stats have been collected."
+                            : summary);
+}
+#endif // PYTOMLPP_PROFILING
+} // namespace
+
+void phase_stats::record(uint64_t elapsed_ns) noexcept {
+  count.fetch_add(1, std::memory_order_relaxed);
+  total_ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+
+  auto current = min_ns.load(std::memory_order_relaxed);
+  while (elapsed_ns < current &&
+         !min_ns.compare_exchange_weak(current, elapsed_ns,
+                                       std::memory_order_relaxed))
+    ;
+  current = max_ns.load(std::memory_order_relaxed);
+  while (elapsed_ns > current &&
+         !max_ns.compare_exchange_weak(current, elapsed_ns,
+                                       std::memory_order_relaxed))
+    ;
+
+  // bucket i counts durations below 2^i ns (the last one takes the rest)
+  size_t bucket = 0;
+  while (bucket + 1 < histogram_buckets &&
+         (uint64_t{1} << bucket) <= elapsed_ns)
+    bucket++;
+  histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void phase_stats::reset() noexcept {
+  count.store(0, std::memory_order_relaxed);
+  total_ns.store(0, std::memory_order_relaxed);
+  min_ns.store(std::numeric_limits<uint64_t>::max(),
+               std::memory_order_relaxed);
+  max_ns.store(0, std::memory_order_relaxed);
+  for (auto &bucket : histogram)
+    bucket.store(0, std::memory_order_relaxed);
+}
+
+phase_stats &register_phase(const char *name) {
+  std::lock_guard<std::mutex> lock{phases_mutex};
+  for (auto &phase : phases) {
+    if (std::strcmp(phase.name, name) == 0)
+      return phase;
+  }
+  return phases.emplace_back(name);
+}
+} // namespace pytomlpp::profiling
+
+namespace pytomlpp {
+void register_profiling(py::module &m) {
+  m.def(
+      "enable_profiling",
+      [](bool enable) {
+        profiling::enabled.store(enable, std::memory_order_relaxed);
+      },
+      py::arg("enable") = true);
+  m.def("is_profiling_enabled", []() { return profiling::is_enabled(); });
+  m.def("get_stats", &profiling::get_stats);
+  m.def("reset_stats", &profiling::reset_stats);
+
+#if PYTOMLPP_PROFILING
+  auto atexit = py::module::import("atexit");
+  atexit.attr("register")(py::cpp_function(profiling::print_stats));
+#endif
+}
+} // namespace pytomlpp
@@ -1,129 +1,656 @@
 #define TOML_IMPLEMENTATION
 #include <pytomlpp/pytomlpp.hpp>
-#if PYTOMLPP_PROFILING
-#include <chrono>
-#include <iomanip>
-#include <pybind11/iostream.h>
-#endif // PYTOMLPP_PROFILING
+#include <pytomlpp/io.hpp>
+#include <pytomlpp/parallel.hpp>
+#include <pytomlpp/profiling.hpp>
+#include <pybind11/stl.h>
+#include <cmath>
+#include <limits>
+#include <vector>
 
 PYTOMLPP_PUSH_OPTIMIZATIONS;
 
+namespace pytomlpp {
 namespace {
-#if PYTOMLPP_PROFILING
-using namespace std::string_view_literals;
-
-struct profiling_stats_entry {
-  long long counter;
-  double total_time_in_ns;
-};
-
-std::unordered_map<std::string_view, profiling_stats_entry> profiling_stats;
-
-void print_profiling_stats() noexcept {
-  py::print("\npytomlpp profiling summary:\n-----------------------------");
-  if (profiling_stats.empty())
-    py::print("no profiling stats have been collected.");
-  else {
-    std::ostringstream oss;
-    for (const auto &[key, entry] : profiling_stats) {
-      oss << std::setw(15) << key << ": "sv
-          << " counter = "sv << std::setw(7) << entry.counter
-          << ", total_time_in_ns = "sv << std::setw(12)
-          << (long long)entry.total_time_in_ns << ", average_time_in_ns = "sv
-          << std::setw(7) << (long long)(entry.total_time_in_ns / entry.counter)
-          << "\n"sv;
-    }
-    py::print(oss.str());
-  }
+DecodeError to_decode_error(const toml::parse_error &e) {
+  std::stringstream ss;
+  ss << e;
+  auto source_region = e.source();
+  auto s_begin = source_region.begin;
+  auto s_end = source_region.end;
+  auto path = source_region.path;
+  return DecodeError(ss.str(), static_cast<int>(s_begin.line),
+                     static_cast<int>(s_begin.column),
+                     static_cast<int>(s_end.line),
+                     static_cast<int>(s_end.column), path);
 }
+} // namespace
 
-class profiling_guard {
-  profiling_stats_entry &entry;
-  std::chrono::time_point<std::chrono::high_resolution_clock> start;
-
-public:
-  profiling_guard(profiling_stats_entry &entry) noexcept
-      : entry{entry}, start{std::chrono::high_resolution_clock::now()} {}
-
-  ~profiling_guard() noexcept {
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::nano> duration = end - start;
-    double execution_time_in_ns = duration.count();
+void throw_decode_error(const toml::parse_error &e) {
+  throw to_decode_error(e);
+}
 
-    entry.counter += 1;
-    entry.total_time_in_ns += execution_time_in_ns;
+std::string_view document_view(py::handle document) {
+  if (PyUnicode_Check(document.ptr())) {
+    Py_ssize_t size = 0;
+    const char *data = PyUnicode_AsUTF8AndSize(document.ptr(), &size);
+    if (!data)
+      throw py::error_already_set();
+    return {data, static_cast<size_t>(size)};
   }
-};
+  if (PyBytes_Check(document.ptr())) {
+    char *data = nullptr;
+    Py_ssize_t size = 0;
+    if (PyBytes_AsStringAndSize(document.ptr(), &data, &size) != 0)
+      throw py::error_already_set();
+    return {data, static_cast<size_t>(size)};
+  }
+  throw py::type_error(
+      py::str("expected str or bytes, got {}").format(py::type::of(document)));
+}
+} // namespace pytomlpp
 
-#define PROFILE_SCOPE_2(line, name)                                            \
-  static auto &profiling_stats_entry##line = profiling_stats[name];            \
-  profiling_guard profiling_guard##line { profiling_stats_entry##line }
-#define PROFILE_SCOPE_1(line, name) PROFILE_SCOPE_2(line, name)
-#define PROFILE_SCOPE(name) PROFILE_SCOPE_1(__LINE__, name)
-#else
-#define PROFILE_SCOPE(name) (void)0
-#endif // PYTOMLPP_PROFILING
+namespace {
+using pytomlpp::document_view;
+using pytomlpp::throw_decode_error;
+using pytomlpp::profiling::counter;
 
 std::string TPP_VERSION = std::to_string(TOML_LIB_MAJOR) + "." +
                           std::to_string(TOML_LIB_MINOR) + "." +
                           std::to_string(TOML_LIB_PATCH);
 
-py::dict loads(std::string_view toml_string) {
+py::handle decode_error_type;
+py::handle schema_error_type;
+
+py::object make_decode_error(const pytomlpp::DecodeError &e,
+                             py::handle type = decode_error_type) {
+  py::object error = py::reinterpret_borrow<py::object>(type)(e.what());
+  error.attr("start_line") = e.start_line;
+  error.attr("start_col") = e.start_col;
+  error.attr("end_line") = e.end_line;
+  error.attr("end_col") = e.end_col;
+  if (e.path)
+    error.attr("path") = py::reinterpret_steal<py::object>(
+        PyUnicode_DecodeFSDefaultAndSize(
+            e.path->data(), static_cast<Py_ssize_t>(e.path->size())));
+  else
+    error.attr("path") = py::none();
+  return error;
+}
+
+py::object to_python(toml::table &&tbl, bool lazy, bool numeric_buffers) {
+  if (lazy)
+    return pytomlpp::make_lazy_table(
+        std::make_shared<const toml::table>(std::move(tbl)));
+  return pytomlpp::toml_table_to_py_dict(std::move(tbl), numeric_buffers);
+}
+
+py::object loads(const py::object &document, bool lazy,
+                 bool numeric_buffers) {
   try {
     PROFILE_SCOPE("loads.total");
+    const std::string_view toml_string = document_view(document);
+    pytomlpp::profiling::add(counter::bytes_in, toml_string.size());
     toml::table tbl;
     {
       PROFILE_SCOPE("loads.parse");
+      py::gil_scoped_release release;
       tbl = toml::parse(toml_string);
     }
-    py::dict d;
+    py::object d;
     {
       PROFILE_SCOPE("loads.convert");
-      d = pytomlpp::toml_table_to_py_dict(std::move(tbl));
+      d = to_python(std::move(tbl), lazy, numeric_buffers);
+    }
+    return d;
+  } catch (const toml::parse_error &e) {
+    throw_decode_error(e);
+  }
+}
+
+// maps and parses a file with the GIL released
+toml::table parse_file(const std::string &path) {
+  toml::table tbl;
+  int error_code = 0;
+  {
+    py::gil_scoped_release release;
+    pytomlpp::file_contents file{path};
+    error_code = file.error();
+    pytomlpp::profiling::add(counter::bytes_in, file.view().size());
+    if (!error_code)
+      tbl = toml::parse(file.view(), std::string_view{path});
+  }
+  if (error_code)
+    pytomlpp::throw_os_error(error_code, path);
+  return tbl;
+}
+
+py::object load_file(const std::string &path, bool lazy,
+                     bool numeric_buffers) {
+  try {
+    PROFILE_SCOPE("load_file.total");
+    toml::table tbl;
+    {
+      PROFILE_SCOPE("load_file.parse");
+      tbl = parse_file(path);
+    }
+    py::object d;
+    {
+      PROFILE_SCOPE("load_file.convert");
+      d = to_python(std::move(tbl), lazy, numeric_buffers);
     }
     return d;
   } catch (const toml::parse_error &e) {
-    std::stringstream ss;
-    ss << e;
-    auto source_region = e.source();
-    auto s_begin = source_region.begin;
-    auto s_end = source_region.end;
-    auto path = source_region.path;
-    throw pytomlpp::DecodeError(ss.str(), static_cast<int>(s_begin.line),
-                                static_cast<int>(s_begin.column),
-                                static_cast<int>(s_end.line),
-                                static_cast<int>(s_end.column), path);
+    throw_decode_error(e);
+  }
+}
+
+// rethrows the first error captured on a worker thread, parse errors as
+// DecodeError
+void rethrow_first_error(const std::vector<std::exception_ptr> &errors) {
+  for (auto &error : errors) {
+    if (!error)
+      continue;
+    try {
+      std::rethrow_exception(error);
+    } catch (const toml::parse_error &e) {
+      throw_decode_error(e);
+    }
+  }
+}
+
+py::list to_python_list(std::vector<toml::table> &&tables) {
+  py::list result(tables.size());
+  for (size_t i = 0; i < tables.size(); i++)
+    result[i] = pytomlpp::toml_table_to_py_dict(std::move(tables[i]));
+  return result;
+}
+
+py::list loads_many(const py::iterable &documents, size_t threads) {
+  PROFILE_SCOPE("loads_many.total");
+  // hold a reference to every document so their buffers outlive the parse
+  std::vector<py::object> owners;
+  std::vector<std::string_view> texts;
+  for (auto &&document : documents) {
+    texts.push_back(document_view(document));
+    owners.push_back(py::reinterpret_borrow<py::object>(document));
+    pytomlpp::profiling::add(counter::bytes_in, texts.back().size());
+  }
+
+  std::vector<toml::table> tables(texts.size());
+  std::vector<std::exception_ptr> errors(texts.size());
+  {
+    PROFILE_SCOPE("loads_many.parse");
+    py::gil_scoped_release release;
+    pytomlpp::parallel_for(texts.size(), threads, [&](size_t i) {
+      try {
+        tables[i] = toml::parse(texts[i]);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+
+  rethrow_first_error(errors);
+
+  PROFILE_SCOPE("loads_many.convert");
+  return to_python_list(std::move(tables));
+}
+
+py::list load_files(const std::vector<std::string> &paths, size_t threads) {
+  PROFILE_SCOPE("load_files.total");
+  std::vector<toml::table> tables(paths.size());
+  std::vector<int> error_codes(paths.size());
+  std::vector<std::exception_ptr> errors(paths.size());
+  {
+    PROFILE_SCOPE("load_files.parse");
+    py::gil_scoped_release release;
+    pytomlpp::parallel_for(paths.size(), threads, [&](size_t i) {
+      try {
+        pytomlpp::file_contents file{paths[i]};
+        if ((error_codes[i] = file.error()))
+          return;
+        pytomlpp::profiling::add(counter::bytes_in, file.view().size());
+        tables[i] = toml::parse(file.view(), std::string_view{paths[i]});
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+
+  for (size_t i = 0; i < paths.size(); i++) {
+    if (error_codes[i])
+      pytomlpp::throw_os_error(error_codes[i], paths[i]);
+  }
+  rethrow_first_error(errors);
+
+  PROFILE_SCOPE("load_files.convert");
+  return to_python_list(std::move(tables));
+}
+
+// parses only, returning None or the DecodeError instance instead of raising
+// the OSError throw_os_error raises, as an object
+py::object make_os_error(int error_code, const std::string &path) {
+  try {
+    pytomlpp::throw_os_error(error_code, path);
+  } catch (const py::error_already_set &e) {
+    return e.value();
+  }
+}
+
+py::object validate(const py::object &document) {
+  PROFILE_SCOPE("validate.total");
+  const std::string_view toml_string = document_view(document);
+  pytomlpp::profiling::add(counter::bytes_in, toml_string.size());
+  try {
+    py::gil_scoped_release release;
+    static_cast<void>(toml::parse(toml_string));
+  } catch (const toml::parse_error &e) {
+    return make_decode_error(pytomlpp::to_decode_error(e));
+  }
+  return py::none();
+}
+
+py::list validate_files(const std::vector<std::string> &paths,
+                        size_t threads) {
+  PROFILE_SCOPE("validate_files.total");
+  std::vector<std::unique_ptr<pytomlpp::DecodeError>> decode_errors(
+      paths.size());
+  std::vector<int> error_codes(paths.size());
+  std::vector<std::exception_ptr> errors(paths.size());
+  {
+    py::gil_scoped_release release;
+    pytomlpp::parallel_for(paths.size(), threads, [&](size_t i) {
+      try {
+        pytomlpp::file_contents file{paths[i]};
+        if ((error_codes[i] = file.error()))
+          return;
+        pytomlpp::profiling::add(counter::bytes_in, file.view().size());
+        static_cast<void>(
+            toml::parse(file.view(), std::string_view{paths[i]}));
+      } catch (const toml::parse_error &e) {
+        decode_errors[i] = std::make_unique<pytomlpp::DecodeError>(
+            pytomlpp::to_decode_error(e));
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+
+  rethrow_first_error(errors);
+
+  // an unreadable file is reported in its slot like a decode error, the
+  // results for the other paths stay available
+  py::list result(paths.size());
+  for (size_t i = 0; i < paths.size(); i++) {
+    if (error_codes[i])
+      result[i] = make_os_error(error_codes[i], paths[i]);
+    else if (decode_errors[i])
+      result[i] = make_decode_error(*decode_errors[i]);
+    else
+      result[i] = py::none();
+  }
+  return result;
+}
+
+py::dict select_paths(const toml::table &tbl,
+                      const std::vector<std::string> &paths) {
+  py::dict result;
+  for (const auto &path : paths) {
+    if (const toml::node *node = toml::at_path(tbl, path).node())
+      result[py::str(path)] = pytomlpp::toml_node_to_py(*node);
+  }
+  return result;
+}
+
+py::dict loads_paths(const py::object &document,
+                     const std::vector<std::string> &paths) {
+  try {
+    PROFILE_SCOPE("loads_paths.total");
+    const std::string_view toml_string = document_view(document);
+    pytomlpp::profiling::add(counter::bytes_in, toml_string.size());
+    toml::table tbl;
+    {
+      PROFILE_SCOPE("loads_paths.parse");
+      py::gil_scoped_release release;
+      tbl = toml::parse(toml_string);
+    }
+    PROFILE_SCOPE("loads_paths.convert");
+    return select_paths(tbl, paths);
+  } catch (const toml::parse_error &e) {
+    throw_decode_error(e);
   }
 }
 
-std::string dumps(py::dict object) {
+py::dict load_file_paths(const std::string &path,
+                         const std::vector<std::string> &paths) {
   try {
-    PROFILE_SCOPE("dumps.total");
-    toml::table t;
+    PROFILE_SCOPE("load_file_paths.total");
+    toml::table tbl;
     {
-      PROFILE_SCOPE("dumps.convert");
-      t = pytomlpp::py_dict_to_toml_table(object);
+      PROFILE_SCOPE("load_file_paths.parse");
+      tbl = parse_file(path);
     }
-    std::stringstream ss;
-    ss << t;
-    return ss.str();
+    PROFILE_SCOPE("load_file_paths.convert");
+    return select_paths(tbl, paths);
+  } catch (const toml::parse_error &e) {
+    throw_decode_error(e);
+  }
+}
+
+// output_sink forwarding every chunk to a python object's write(bytes); the
+// GIL must be held while formatting into it.
+class python_sink final : public pytomlpp::output_sink {
+  py::object write_;
+  std::exception_ptr error_;
+
+protected:
+  bool write_chunk(const char *data, size_t size) override {
+    try {
+      write_(py::bytes(data, size));
+      return true;
+    } catch (...) {
+      error_ = std::current_exception();
+      return false;
+    }
+  }
+
+public:
+  explicit python_sink(const py::object &writable)
+      : write_{writable.attr("write")} {}
+
+  void finish_or_throw() {
+    if (!finish() && error_)
+      std::rethrow_exception(error_);
+  }
+};
+
+// dumps and friends always convert into a toml::table and let toml++ format
+// it: the output then follows the vendored formatter exactly, and canonical
+// mode, hashing, dumps_many and Document.save share one formatting path. A
+// direct python-to-text emitter would have to track every formatter rule
+// (quoting, string styles, float printing, array wrapping) to stay identical.
+toml::table to_toml(const py::object &object) {
+  try {
+    return pytomlpp::py_mapping_to_toml_table(object);
   } catch (const std::runtime_error &e) {
     throw py::type_error(e.what());
   }
 }
 
+std::string format_table(const toml::table &t,
+                         pytomlpp::fnv1a *hash = nullptr) {
+  std::string out;
+  out.reserve(4096);
+  pytomlpp::string_sink sink{out, hash};
+  std::ostream os{&sink};
+  os << t;
+  pytomlpp::profiling::add(counter::bytes_out, out.size());
+  return out;
+}
+
+// days since 1970-01-01 of a proleptic gregorian date and back, after
+// http://howardhinnant.github.io/date_algorithms.html
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d) noexcept {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const auto yoe = static_cast<unsigned>(y - era * 400);
+  const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+toml::date civil_from_days(int64_t z) noexcept {
+  z += 719468;
+  const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const auto doe = static_cast<unsigned>(z - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+  const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+  const int64_t y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+  return {static_cast<uint16_t>(y), static_cast<uint8_t>(m),
+          static_cast<uint8_t>(d)};
+}
+
+// Rewrites values that have several spellings into one: -0.0 becomes 0.0,
+// every NaN the same quiet NaN and offset date-times are moved to UTC (Z).
+// Keys need no sorting, toml++ tables are already ordered by key. Raises
+// ValueError (as a plain C++ exception, the GIL may be released) when moving
+// a date-time to UTC takes it outside years 1-9999.
+void canonicalize(toml::node &node) {
+  node.visit([](auto &&val) {
+    if constexpr (toml::is_table<decltype(val)>) {
+      for (auto &&kvp : val)
+        canonicalize(kvp.second);
+    } else if constexpr (toml::is_array<decltype(val)>) {
+      for (auto &item : val)
+        canonicalize(item);
+    } else if constexpr (toml::is_floating_point<decltype(val)>) {
+      double &v = val.get();
+      if (std::isnan(v))
+        v = std::numeric_limits<double>::quiet_NaN();
+      else if (v == 0.0)
+        v = 0.0;
+    } else if constexpr (toml::is_date_time<decltype(val)>) {
+      toml::date_time &dt = val.get();
+      if (!dt.offset || dt.offset->minutes == 0)
+        return;
+      const int64_t minutes =
+          days_from_civil(dt.date.year, dt.date.month, dt.date.day) * 1440 +
+          dt.time.hour * 60 + dt.time.minute - dt.offset->minutes;
+      const int64_t days = (minutes >= 0 ? minutes : minutes - 1439) / 1440;
+      const int64_t minute_of_day = minutes - days * 1440;
+      static const int64_t first_day = days_from_civil(1, 1, 1);
+      static const int64_t last_day = days_from_civil(9999, 12, 31);
+      if (days < first_day || days > last_day)
+        throw py::value_error("date-time with an offset is outside years "
+                              "1-9999 once converted to UTC");
+      dt.date = civil_from_days(days);
+      dt.time.hour = static_cast<uint8_t>(minute_of_day / 60);
+      dt.time.minute = static_cast<uint8_t>(minute_of_day % 60);
+      dt.offset = toml::time_offset{};
+    }
+  });
+}
+
+// formats with the GIL released; fills hash when given
+std::string format_document(toml::table &t, bool canonical,
+                            pytomlpp::fnv1a *hash) {
+  py::gil_scoped_release release;
+  if (canonical)
+    canonicalize(t);
+  return format_table(t, hash);
+}
+
+// the text alone, or (text, hash) when return_hash was requested
+py::object with_hash(py::object text, bool return_hash,
+                     const pytomlpp::fnv1a &hash) {
+  if (!return_hash)
+    return text;
+  return py::make_tuple(std::move(text), hash.value());
+}
+
+py::object dumps(const py::object &object, bool canonical, bool return_hash) {
+  PROFILE_SCOPE("dumps.total");
+  toml::table t;
+  {
+    PROFILE_SCOPE("dumps.convert");
+    t = to_toml(object);
+  }
+  PROFILE_SCOPE("dumps.format");
+  pytomlpp::fnv1a hash;
+  const std::string out =
+      format_document(t, canonical, return_hash ? &hash : nullptr);
+  return with_hash(py::str(out), return_hash, hash);
+}
+
+py::object dumps_bytes(const py::object &object, bool canonical,
+                       bool return_hash) {
+  PROFILE_SCOPE("dumps_bytes.total");
+  toml::table t;
+  {
+    PROFILE_SCOPE("dumps_bytes.convert");
+    t = to_toml(object);
+  }
+  PROFILE_SCOPE("dumps_bytes.format");
+  pytomlpp::fnv1a hash;
+  const std::string out =
+      format_document(t, canonical, return_hash ? &hash : nullptr);
+  return with_hash(py::bytes(out), return_hash, hash);
+}
+
+py::list dumps_many(const py::iterable &objects, size_t threads,
+                    bool as_bytes) {
+  PROFILE_SCOPE("dumps_many.total");
+  std::vector<toml::table> tables;
+  {
+    PROFILE_SCOPE("dumps_many.convert");
+    for (auto &&object : objects)
+      tables.push_back(to_toml(py::reinterpret_borrow<py::object>(object)));
+  }
+
+  std::vector<std::string> outputs(tables.size());
+  std::vector<std::exception_ptr> errors(tables.size());
+  {
+    PROFILE_SCOPE("dumps_many.format");
+    py::gil_scoped_release release;
+    pytomlpp::parallel_for(tables.size(), threads, [&](size_t i) {
+      try {
+        outputs[i] = format_table(tables[i]);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+  rethrow_first_error(errors);
+
+  py::list result(outputs.size());
+  for (size_t i = 0; i < outputs.size(); i++) {
+    if (as_bytes)
+      result[i] = py::bytes(outputs[i]);
+    else
+      result[i] = py::str(outputs[i]);
+    std::string{}.swap(outputs[i]); // release each string once copied
+  }
+  return result;
+}
+
+// returns errno of the failed write, 0 on success
+int write_to_fd(const toml::table &t, int fd) {
+  py::gil_scoped_release release;
+  pytomlpp::fd_sink sink{fd};
+  std::ostream os{&sink};
+  os << t;
+  const bool ok = sink.finish();
+  pytomlpp::profiling::add(counter::bytes_out, sink.bytes_written());
+  return ok ? 0 : sink.error();
+}
+
+void dump_to(const py::object &object, const py::object &target) {
+  PROFILE_SCOPE("dump_to.total");
+  // bool is an int subclass, True would silently mean stdout
+  if (PyBool_Check(target.ptr()))
+    throw py::type_error("cannot dump to a bool, expected a file descriptor, "
+                         "path or writable object");
+  toml::table t;
+  {
+    PROFILE_SCOPE("dump_to.convert");
+    t = to_toml(object);
+  }
+  PROFILE_SCOPE("dump_to.format");
+  if (PyLong_Check(target.ptr())) {
+    if (const int error_code = write_to_fd(t, target.cast<int>()))
+      pytomlpp::throw_errno_error(error_code, {});
+  } else if (py::hasattr(target, "write")) {
+    python_sink sink{target};
+    std::ostream os{&sink};
+    os << t;
+    sink.finish_or_throw();
+    pytomlpp::profiling::add(counter::bytes_out, sink.bytes_written());
+  } else if (PyUnicode_Check(target.ptr()) || PyBytes_Check(target.ptr())) {
+    const auto path = target.cast<std::string>();
+    int fd = -1;
+    int open_error = 0;
+    {
+      py::gil_scoped_release release;
+      fd = pytomlpp::open_for_writing(path);
+      open_error = errno;
+    }
+    if (fd < 0)
+      pytomlpp::throw_errno_error(open_error, path);
+    int error_code = write_to_fd(t, fd);
+    if (const int close_error = pytomlpp::close_file(fd); !error_code)
+      error_code = close_error;
+    if (error_code)
+      pytomlpp::throw_errno_error(error_code, path);
+  } else
+    throw py::type_error(
+        py::str("cannot dump to {}, expected a file descriptor, path or "
+                "writable object")
+            .format(py::type::of(target)));
+}
+
 } // namespace
 
+// Native state is either immutable after import, atomic, or guarded by a
+// mutex, and dumps holds the per-object lock of the dicts and lists it walks
+// (critical_section), so free-threaded (Py_GIL_DISABLED) builds can run
+// without the GIL.
+#if PYBIND11_VERSION_HEX >= 0x020D0000
+PYBIND11_MODULE(_impl, m, py::mod_gil_not_used()) {
+#else
 PYBIND11_MODULE(_impl, m) {
+#endif
   m.doc() = "tomlplusplus python wrapper";
   m.attr("lib_version") = TPP_VERSION;
-  m.def("loads", &loads);
-  m.def("dumps", &dumps);
+  pytomlpp::import_datetime();
+  pytomlpp::import_abc_types();
+  m.def("loads", &loads, py::arg("data"), py::arg("lazy") = false,
+        py::arg("numeric_buffers") = false);
+  m.def("load_file", &load_file, py::arg("path"), py::arg("lazy") = false,
+        py::arg("numeric_buffers") = false);
+  m.def("loads_many", &loads_many, py::arg("documents"),
+        py::arg("threads") = 0);
+  m.def("load_files", &load_files, py::arg("paths"), py::arg("threads") = 0);
+  m.def("validate", &validate, py::arg("data"));
+  m.def("validate_files", &validate_files, py::arg("paths"),
+        py::arg("threads") = 0);
+  m.def("loads_paths", &loads_paths, py::arg("data"), py::arg("paths"));
+  m.def("load_file_paths", &load_file_paths, py::arg("path"),
+        py::arg("paths"));
+  m.def("dumps", &dumps, py::arg("data"), py::arg("canonical") = false,
+        py::arg("return_hash") = false);
+  m.def("dumps_bytes", &dumps_bytes, py::arg("data"),
+        py::arg("canonical") = false, py::arg("return_hash") = false);
+  m.def("dumps_many", &dumps_many, py::arg("data"), py::arg("threads") = 0,
+        py::arg("as_bytes") = false);
+  m.def("dump_to", &dump_to, py::arg("data"), py::arg("target"));
 
-#if PYTOMLPP_PROFILING
-  auto atexit = py::module::import("atexit");
-  atexit.attr("register")(py::cpp_function(print_profiling_stats));
-#endif
+  pytomlpp::register_lazy_table(m);
+  pytomlpp::register_profiling(m);
+  pytomlpp::register_cached_loader(m);
+  pytomlpp::register_json(m);
+  pytomlpp::register_schema(m);
+  pytomlpp::register_document(m);
+  pytomlpp::register_incremental_parser(m);
 
-  py::register_exception<pytomlpp::DecodeError>(m, "DecodeError");
+  decode_error_type =
+      py::exception<pytomlpp::DecodeError>(m, "DecodeError").release();
+  schema_error_type = py::exception<pytomlpp::SchemaError>(m, "SchemaError",
+                                                           decode_error_type)
+                          .release();
+  py::register_exception_translator([](std::exception_ptr p) {
+    try {
+      if (p)
+        std::rethrow_exception(p);
+    } catch (const pytomlpp::SchemaError &e) {
+      py::object error = make_decode_error(e, schema_error_type);
+      PyErr_SetObject(schema_error_type.ptr(), error.ptr());
+    } catch (const pytomlpp::DecodeError &e) {
+      py::object error = make_decode_error(e);
+      PyErr_SetObject(decode_error_type.ptr(), error.ptr());
+    }
+  });
 }
@@ -7,7 +7,44 @@ Install from [PyPI](https://pypi.org/project/pytomlpp/)
 
 """
 
-__all__ = ["DecodeError", "dumps", "loads", "dump", "load"]
+__all__ = [
+    "CachedLoader",
+    "ConfigChange",
+    "ConfigSet",
+    "DecodeError",
+    "Document",
+    "IncrementalParser",
+    "SchemaError",
+    "Schema",
+    "Range",
+    "TomlTable",
+    "dumps",
+    "dumps_bytes",
+    "dumps_many",
+    "loads",
+    "loads_many",
+    "loads_paths",
+    "validate",
+    "dump",
+    "load",
+    "load_paths",
+    "loads_as",
+    "load_as",
+    "to_json",
+    "from_json",
+    "enable_profiling",
+    "is_profiling_enabled",
+    "get_stats",
+    "reset_stats",
+]
 
-from ._impl import DecodeError, lib_version
-from ._io import dump, dumps, load, loads
+from collections.abc import Mapping
+
+from ._impl import CachedLoader, DecodeError, Document, IncrementalParser, SchemaError, TomlTable, lib_version
+from ._impl import enable_profiling, get_stats, is_profiling_enabled, reset_stats
+from ._config_set import ConfigChange, ConfigSet
+from ._schema import Range, Schema, load_as, loads_as
+from ._io import (dump, dumps, dumps_bytes, dumps_many, from_json, load, load_paths, loads, loads_many,
+                  loads_paths, to_json, validate)
+
+Mapping.register(TomlTable)
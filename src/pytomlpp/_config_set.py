@@ -0,0 +1,114 @@
+"""A directory of TOML files kept up to date by re-parsing only what changed."""
+
+import os
+from pathlib import Path
+from typing import Any, Dict, FrozenSet, Iterator, List, Mapping, NamedTuple, Tuple, Union
+
+from . import _impl
+
+
+class ConfigChange(NamedTuple):
+    """How one file changed during ``ConfigSet.refresh()``.
+
+    ``status`` is ``"added"``, ``"removed"`` or ``"modified"``; the key sets
+    list the top-level keys that appeared, disappeared or got a new value.
+    """
+
+    status: str
+    added: FrozenSet[str]
+    removed: FrozenSet[str]
+    changed: FrozenSet[str]
+
+
+_Stamp = Tuple[int, int, int]
+
+
+def _diff(status: str, old: Mapping[str, Any], new: Mapping[str, Any]) -> ConfigChange:
+    return ConfigChange(
+        status,
+        frozenset(new.keys() - old.keys()),
+        frozenset(old.keys() - new.keys()),
+        frozenset(key for key in old.keys() & new.keys() if old[key] != new[key]),
+    )
+
+
+class ConfigSet(Mapping[str, Dict[str, Any]]):
+    """TOML files of a directory, keyed by their path relative to it.
+
+    Files are parsed in parallel with the GIL released. ``refresh()`` only
+    stats the files and re-parses the ones whose size, mtime or inode changed.
+
+    Args:
+        directory (Union[str, os.PathLike]): directory to load
+        pattern (str, optional): glob selecting the files. Defaults to "*.toml".
+        recursive (bool, optional): also match files in subdirectories. Defaults to False.
+        threads (int, optional): parser threads, 0 means one per CPU. Defaults to 0.
+    """
+
+    def __init__(self, directory: Union[str, os.PathLike], pattern: str = "*.toml",
+                 recursive: bool = False, threads: int = 0):
+        self._directory = Path(directory)
+        self._pattern = pattern
+        self._recursive = recursive
+        self._threads = threads
+        self._stamps: Dict[str, _Stamp] = {}
+        self._tables: Dict[str, Dict[str, Any]] = {}
+        self.refresh()
+
+    @property
+    def directory(self) -> Path:
+        return self._directory
+
+    def _scan(self) -> Dict[str, _Stamp]:
+        paths = self._directory.rglob(self._pattern) if self._recursive else self._directory.glob(self._pattern)
+        stamps = {}
+        for path in paths:
+            try:
+                st = path.stat()
+            except FileNotFoundError:  # removed while scanning
+                continue
+            if path.is_file():
+                stamps[path.relative_to(self._directory).as_posix()] = (st.st_size, st.st_mtime_ns, st.st_ino)
+        return dict(sorted(stamps.items()))
+
+    def refresh(self) -> Dict[str, ConfigChange]:
+        """Re-stat all files and re-parse the ones that changed.
+
+        The set is only updated if every changed file parses; otherwise the
+        error (``DecodeError`` or ``OSError``) is raised and the previous
+        contents are kept.
+
+        Returns:
+            Dict[str, ConfigChange]: changes per file name; files whose content
+            did not change (e.g. only touched) are left out
+        """
+        stamps = self._scan()
+        stale: List[str] = sorted(name for name, stamp in stamps.items() if self._stamps.get(name) != stamp)
+        paths = [os.fsencode(self._directory / name) for name in stale]
+        tables = dict(zip(stale, _impl.load_files(paths, self._threads)))
+
+        changes = {}
+        for name, table in tables.items():
+            old = self._tables.get(name)
+            if old is None:
+                changes[name] = _diff("added", {}, table)
+            elif old != table:
+                changes[name] = _diff("modified", old, table)
+        for name in self._tables.keys() - stamps.keys():
+            changes[name] = _diff("removed", self._tables[name], {})
+
+        self._stamps = stamps
+        self._tables = {name: tables.get(name, self._tables.get(name)) for name in stamps}
+        return changes
+
+    def __getitem__(self, name: str) -> Dict[str, Any]:
+        return self._tables[name]
+
+    def __iter__(self) -> Iterator[str]:
+        return iter(self._tables)
+
+    def __len__(self) -> int:
+        return len(self._tables)
+
+    def __repr__(self) -> str:
+        return f"ConfigSet({str(self._directory)!r}, files={len(self)})"
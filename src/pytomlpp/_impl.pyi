@@ -1,7 +1,99 @@
+from os import PathLike
+from typing import Any, BinaryIO, Dict, Iterable, Iterator, List, Mapping, Optional, Tuple, Union
 
 lib_version: str = ...
 
 
 class DecodeError(Exception):
     """Error raised when decoding fails."""
-    ...
+    start_line: int
+    start_col: int
+    end_line: int
+    end_col: int
+    path: Optional[str]
+
+
+class SchemaError(DecodeError):
+    """Error raised when a document does not match the schema passed to ``loads_as``."""
+
+
+class SchemaPlan:
+    """Native decoding plan compiled from a schema spec, see ``pytomlpp.Schema``."""
+    def __init__(self, spec: tuple) -> None: ...
+    @property
+    def description(self) -> str: ...
+
+
+class TomlTable(Mapping[str, Any]):
+    """Read-only view of a parsed TOML table, values are converted on first access.
+
+    Tables and scalars are cached; arrays are converted to a new list on every access.
+    """
+    def __getitem__(self, key: str) -> Any: ...
+    def __len__(self) -> int: ...
+    def __iter__(self) -> Iterator[str]: ...
+    def to_dict(self) -> Dict[str, Any]: ...
+
+
+class CachedLoader:
+    """Loads TOML files, reusing the parsed document while the file is unchanged."""
+    def __init__(self, max_bytes: int = 64 * 1024 * 1024) -> None: ...
+    def load(self, path: Union[str, bytes, PathLike], lazy: bool = False) -> Mapping[str, Any]: ...
+    def invalidate(self, path: Union[str, bytes, PathLike]) -> None: ...
+    def clear(self) -> None: ...
+    def stats(self) -> Dict[str, int]: ...
+    def __len__(self) -> int: ...
+
+
+class Document:
+    """A parsed document edited in place by key path, e.g. ``"servers[0].host"``."""
+    def __init__(self, data: Union[str, bytes] = "") -> None: ...
+    @staticmethod
+    def load(path: Union[str, bytes, PathLike]) -> "Document": ...
+    @property
+    def path(self) -> Optional[str]: ...
+    def get(self, path: str, default: Any = None) -> Any: ...
+    def set(self, path: str, value: Any) -> None: ...
+    def delete(self, path: str) -> None: ...
+    def __getitem__(self, path: str) -> Any: ...
+    def __setitem__(self, path: str, value: Any) -> None: ...
+    def __delitem__(self, path: str) -> None: ...
+    def __contains__(self, path: str) -> bool: ...
+    def save(self, path: Optional[Union[str, bytes, PathLike]] = None) -> None: ...
+    def dumps(self) -> str: ...
+    def to_dict(self) -> Dict[str, Any]: ...
+
+
+class IncrementalParser:
+    """Accumulates a document fed in chunks natively and parses it on ``close()``."""
+    def __init__(self, size_hint: int = 0) -> None: ...
+    def feed(self, data: Union[str, bytes, bytearray, memoryview]) -> None: ...
+    def close(self, lazy: bool = False) -> Mapping[str, Any]: ...
+    @property
+    def buffered(self) -> int: ...
+    @property
+    def closed(self) -> bool: ...
+
+
+def loads(data: Union[str, bytes], lazy: bool = False, numeric_buffers: bool = False) -> Mapping[str, Any]: ...
+def load_file(path: Union[str, bytes], lazy: bool = False, numeric_buffers: bool = False) -> Mapping[str, Any]: ...
+def loads_many(documents: Iterable[Union[str, bytes]], threads: int = 0) -> List[Dict[str, Any]]: ...
+def load_files(paths: List[bytes], threads: int = 0) -> List[Dict[str, Any]]: ...
+def validate(data: Union[str, bytes]) -> Optional[DecodeError]: ...
+def validate_files(paths: List[bytes], threads: int = 0) -> List[Union[None, DecodeError, OSError]]: ...
+def loads_paths(data: Union[str, bytes], paths: List[str]) -> Dict[str, Any]: ...
+def load_file_paths(path: Union[str, bytes], paths: List[str]) -> Dict[str, Any]: ...
+def dumps(data: Mapping[str, Any], canonical: bool = False, return_hash: bool = False) -> Union[str, Tuple[str, int]]: ...
+def dumps_bytes(data: Mapping[str, Any], canonical: bool = False, return_hash: bool = False) -> Union[bytes, Tuple[bytes, int]]: ...
+def dumps_many(data: Iterable[Mapping[str, Any]], threads: int = 0, as_bytes: bool = False) -> List[Union[str, bytes]]: ...
+def dump_to(data: Mapping[str, Any], target: Union[int, str, bytes, BinaryIO]) -> None: ...
+def toml_to_json(data: Union[str, bytes]) -> bytes: ...
+def toml_file_to_json(path: bytes) -> bytes: ...
+def json_to_toml(data: Union[str, bytes]) -> str: ...
+def json_file_to_toml(path: bytes) -> str: ...
+def loads_as(data: Union[str, bytes], plan: SchemaPlan) -> Any: ...
+def load_file_as(path: bytes, plan: SchemaPlan) -> Any: ...
+def enable_profiling(enable: bool = True) -> None: ...
+def is_profiling_enabled() -> bool: ...
+def get_stats() -> Dict[str, Any]: ...
+def reset_stats() -> None: ...
@@ -1,74 +1,284 @@
 """Python wrapper for Toml++ IO methods."""
 
+import codecs
 import os
-from typing import Any, BinaryIO, Dict, TextIO, Union, Optional
+from typing import Any, BinaryIO, Dict, Iterable, List, Mapping, TextIO, Tuple, Union, Optional
 
 from . import _impl
 
 FilePathOrObject = Union[str, TextIO, BinaryIO, os.PathLike]
 
 
-def dumps(data: Dict[Any, Any]) -> str:
+def dumps(
+    data: Mapping[str, Any], canonical: bool = False, return_hash: bool = False
+) -> Union[str, Tuple[str, int]]:
     """Serialise data to TOML string.
 
+    Keys are always written in sorted order, so equal data gives equal output.
+
+    Args:
+        data (Mapping[str, Any]): input data, a dict or any other mapping; tuples and other
+            sequences are written as arrays, as are one-dimensional buffers of numbers
+            (``array.array``, numpy arrays, ``memoryview``), which are read natively
+        canonical (bool, optional): give values with several spellings a single one: ``-0.0``
+            is written as ``0.0``, NaNs lose their sign and datetimes with a UTC offset are
+            converted to UTC (ValueError if that takes them outside years 1-9999).
+            Defaults to False.
+        return_hash (bool, optional): also return the 64-bit FNV-1a hash of the UTF-8 output,
+            computed while it is written. Defaults to False.
+
+    Returns:
+        Union[str, Tuple[str, int]]: seralised data, or ``(data, hash)`` with ``return_hash``
+    """
+    return _impl.dumps(data, canonical, return_hash)
+
+
+def dumps_bytes(
+    data: Mapping[str, Any], canonical: bool = False, return_hash: bool = False
+) -> Union[bytes, Tuple[bytes, int]]:
+    """Serialise data to UTF-8 encoded TOML.
+
+    Same as ``dumps(data).encode("utf-8")`` without the intermediate string.
+
+    Args:
+        data (Mapping[str, Any]): input data
+        canonical (bool, optional): see ``dumps``. Defaults to False.
+        return_hash (bool, optional): see ``dumps``. Defaults to False.
+
+    Returns:
+        Union[bytes, Tuple[bytes, int]]: seralised data, or ``(data, hash)`` with ``return_hash``
+    """
+    return _impl.dumps_bytes(data, canonical, return_hash)
+
+
+def dumps_many(
+    data: Iterable[Mapping[str, Any]], threads: int = 0, binary: bool = False
+) -> List[Union[str, bytes]]:
+    """Serialise several mappings at once.
+
+    Every mapping is converted to a native table first, then all of them are
+    formatted concurrently on native threads without holding the GIL.
+
     Args:
-        data (Dict[Any, Any]): input data
+        data (Iterable[Mapping[str, Any]]): input data, see ``dumps``
+        threads (int, optional): maximum number of formatter threads, 0 uses one per CPU. Defaults to 0.
+        binary (bool, optional): return UTF-8 encoded bytes, as ``dumps_bytes`` does. Defaults to False.
 
     Returns:
-        str: seralised data
+        List[Union[str, bytes]]: seralised data, one document per mapping
     """
-    return _impl.dumps(data)
+    return _impl.dumps_many(data, threads, binary)
 
 
-def dump(data: Dict[Any, Any], fl: FilePathOrObject, mode: str = "w", encoding: Optional[str] = None) -> None:
+def dump(data: Mapping[str, Any], fl: FilePathOrObject, mode: str = "w", encoding: Optional[str] = None) -> None:
     """Serialise data to TOML file
 
+    Binary writes and UTF-8 writes to a path are streamed natively to the
+    destination in chunks, without building the whole document in memory first.
+
     Args:
-        data (Dict[Any, Any]): input data
+        data (Mapping[str, Any]): input data
         fl (FilePathOrObject): file like object or path
         mode (str, optional): mode to write the file, support "w", "wt" (text) or "wb" (binary). Defaults to "w".
-        encoding (str): defaults to None. If None, local enconding will be selected. 
+        encoding (str): defaults to None. If None, the file is written as UTF-8.
         NOTE: ``If mode is binary mode, encoding optional argument will be negligible.``
     """
-    data = _impl.dumps(data)
-    if mode == "wb":
-        data = data.encode("utf-8")
     if hasattr(fl, "write"):
-        fl.write(data)
+        if mode == "wb":
+            _impl.dump_to(data, fl)
+        else:
+            fl.write(_impl.dumps(data))
         return
-    with open(fl, mode=mode, encoding=encoding) as fh:
-        fh.write(data)
+    native = mode == "wb" or (mode in ("w", "wt") and os.linesep == "\n" and _is_utf8(mode, encoding))
+    if isinstance(fl, (str, bytes, os.PathLike)) and native:
+        _impl.dump_to(data, os.fsencode(fl))
+        return
+    with open(fl, mode=mode, encoding=None if mode == "wb" else encoding or "utf-8") as fh:
+        fh.write(_impl.dumps_bytes(data) if mode == "wb" else _impl.dumps(data))
 
 
-def loads(data: str) -> Dict[Any, Any]:
+def _numeric_buffers(homogeneous_arrays: str, lazy: bool) -> bool:
+    if homogeneous_arrays not in ("list", "buffer"):
+        raise ValueError(f"homogeneous_arrays must be 'list' or 'buffer', not {homogeneous_arrays!r}")
+    if homogeneous_arrays == "buffer" and lazy:
+        raise ValueError("homogeneous_arrays='buffer' is not supported with lazy=True")
+    return homogeneous_arrays == "buffer"
+
+
+def loads(data: Union[str, bytes], lazy: bool = False, homogeneous_arrays: str = "list") -> Mapping[str, Any]:
     """Deserialise from TOML string to python dict.
 
     Args:
-        data (str): TOML string
+        data (Union[str, bytes]): TOML string, bytes must be UTF-8
+        lazy (bool, optional): return a read-only ``TomlTable`` mapping which only converts
+            the values that are accessed, instead of a dict. Defaults to False.
+        homogeneous_arrays (str, optional): "buffer" returns non-empty arrays holding only
+            integers or only floats as ``array.array('q')`` / ``array.array('d')``, filled
+            natively without creating an object per item; "list" always returns lists.
+            Defaults to "list".
+
+    Returns:
+        Mapping[str, Any]: deserialised data
+    """
+    return _impl.loads(data, lazy, _numeric_buffers(homogeneous_arrays, lazy))
+
+
+def loads_many(data: Iterable[Union[str, bytes]], threads: int = 0) -> List[Dict[Any, Any]]:
+    """Deserialise several TOML documents at once.
+
+    The documents are parsed concurrently on native threads without holding
+    the GIL, then converted to python dicts in order.
+
+    Args:
+        data (Iterable[Union[str, bytes]]): TOML documents, bytes must be UTF-8
+        threads (int, optional): maximum number of parser threads, 0 uses one per CPU. Defaults to 0.
 
     Returns:
-        Dict[Any, Any]: deserialised data
+        List[Dict[Any, Any]]: deserialised data, one dict per document
     """
-    return _impl.loads(data)
+    return _impl.loads_many(data, threads)
 
 
-def load(fl: FilePathOrObject, mode: str = "r", encoding: Optional[str] = None) -> Dict[Any, Any]:
+def _is_utf8(mode: str, encoding: Optional[str]) -> bool:
+    return "b" in mode or encoding is None or codecs.lookup(encoding).name == "utf-8"
+
+
+def load(
+    fl: FilePathOrObject,
+    mode: str = "r",
+    encoding: Optional[str] = None,
+    lazy: bool = False,
+    homogeneous_arrays: str = "list",
+) -> Mapping[str, Any]:
     """Deserialise from TOML file to python dict.
 
+    Paths are read and parsed natively without building an intermediate
+    python string; TOML files are UTF-8 by definition so this is used unless a
+    different ``encoding`` is requested explicitly.
+
     Args:
         fl (FilePathOrObject): file like object or path
         mode (str, optional): mode to read the file, support "r", "rt" (text) or "rb" (binary). Defaults to "r".
-        encoding (str): defaults to None. If None, local enconding will be selected. 
+        encoding (str): defaults to None. If None, the file is read as UTF-8.
         NOTE: ``If mode is binary mode, encoding optional argument will be negligible.``
-          
+        lazy (bool, optional): return a read-only ``TomlTable`` mapping, see ``loads``. Defaults to False.
+        homogeneous_arrays (str, optional): "list" or "buffer", see ``loads``. Defaults to "list".
+
     Returns:
-        Dict[Any, Any]: deserialised data
+        Mapping[str, Any]: deserialised data
     """
+    buffers = _numeric_buffers(homogeneous_arrays, lazy)
     if hasattr(fl, "read"):
-        data = fl.read()
-    else:
-        with open(fl, mode=mode, encoding=encoding) as fh:
-            data = fh.read()
-    if isinstance(data, bytes):
-        return _impl.loads(data.decode("utf-8"))
-    return _impl.loads(data)
+        return _impl.loads(fl.read(), lazy, buffers)
+    if isinstance(fl, (str, bytes, os.PathLike)) and _is_utf8(mode, encoding):
+        return _impl.load_file(os.fsencode(fl), lazy, buffers)
+    with open(fl, mode=mode, encoding=encoding) as fh:
+        return _impl.loads(fh.read(), lazy, buffers)
+
+
+def validate(
+    data: Union[str, bytes, os.PathLike, Iterable[Union[str, bytes, os.PathLike]]], threads: int = 0
+) -> Union[Optional[_impl.DecodeError], List[Union[None, _impl.DecodeError, OSError]]]:
+    """Check that TOML parses, without converting anything to python objects.
+
+    Args:
+        data: a TOML string (bytes must be UTF-8), the path of a TOML file as an
+            ``os.PathLike`` such as ``pathlib.Path``, or an iterable of file paths
+            (str, bytes or ``os.PathLike``) which are parsed concurrently with the GIL released
+        threads (int, optional): maximum number of parser threads for an iterable of paths,
+            0 uses one per CPU. Defaults to 0.
+
+    Raises:
+        OSError: a single ``os.PathLike`` file cannot be read
+
+    Returns:
+        ``None`` if the document is valid, otherwise the ``DecodeError`` that ``loads``
+        would raise (not raised here); a list of those, one per path, for an iterable,
+        where a file that cannot be read gets its ``OSError`` instead
+    """
+    if isinstance(data, (str, bytes)):
+        return _impl.validate(data)
+    if isinstance(data, os.PathLike):
+        result = _impl.validate_files([os.fsencode(data)], 1)[0]
+        if isinstance(result, OSError):
+            raise result
+        return result
+    return _impl.validate_files([os.fsencode(path) for path in data], threads)
+
+
+def loads_paths(data: Union[str, bytes], paths: Iterable[str]) -> Dict[str, Any]:
+    """Deserialise only selected values from a TOML string.
+
+    Only the nodes matched by ``paths`` are converted to python objects, the
+    rest of the document is never materialised.
+
+    Args:
+        data (Union[str, bytes]): TOML string, bytes must be UTF-8
+        paths (Iterable[str]): toml++ style paths such as ``"server.port"`` or ``"servers[0].name"``
+
+    Returns:
+        Dict[str, Any]: the value of every path found in the document, keyed by path
+    """
+    return _impl.loads_paths(data, list(paths))
+
+
+def load_paths(
+    fl: FilePathOrObject, paths: Iterable[str], mode: str = "r", encoding: Optional[str] = None
+) -> Dict[str, Any]:
+    """Deserialise only selected values from a TOML file, see ``loads_paths``.
+
+    Args:
+        fl (FilePathOrObject): file like object or path
+        paths (Iterable[str]): toml++ style paths such as ``"server.port"`` or ``"servers[0].name"``
+        mode (str, optional): mode to read the file, support "r", "rt" (text) or "rb" (binary). Defaults to "r".
+        encoding (str): defaults to None. If None, the file is read as UTF-8.
+
+    Returns:
+        Dict[str, Any]: the value of every path found in the document, keyed by path
+    """
+    paths = list(paths)
+    if hasattr(fl, "read"):
+        return _impl.loads_paths(fl.read(), paths)
+    if isinstance(fl, (str, bytes, os.PathLike)) and _is_utf8(mode, encoding):
+        return _impl.load_file_paths(os.fsencode(fl), paths)
+    with open(fl, mode=mode, encoding=encoding) as fh:
+        return _impl.loads_paths(fh.read(), paths)
+
+
+def to_json(data: Union[str, bytes, os.PathLike]) -> bytes:
+    """Transcode TOML to JSON without creating python objects.
+
+    The document is parsed and formatted natively with the GIL released;
+    dates and times become strings.
+
+    Args:
+        data (Union[str, bytes, os.PathLike]): TOML string (bytes must be UTF-8), or the path of a
+            TOML file as an ``os.PathLike`` such as ``pathlib.Path``
+
+    Returns:
+        bytes: UTF-8 encoded JSON
+    """
+    if isinstance(data, os.PathLike):
+        return _impl.toml_file_to_json(os.fsencode(data))
+    return _impl.toml_to_json(data)
+
+
+def from_json(data: Union[str, bytes, os.PathLike]) -> str:
+    """Transcode a JSON object to TOML without creating python objects.
+
+    ``null`` has no TOML equivalent and is rejected, integers outside the
+    64-bit range become floats.
+
+    Args:
+        data (Union[str, bytes, os.PathLike]): JSON string (bytes must be UTF-8), or the path of a
+            JSON file as an ``os.PathLike`` such as ``pathlib.Path``
+
+    Raises:
+        ValueError: the input is not valid JSON or cannot be represented in TOML
+
+    Returns:
+        str: seralised TOML
+    """
+    if isinstance(data, os.PathLike):
+        return _impl.json_file_to_toml(os.fsencode(data))
+    return _impl.json_to_toml(data)
@@ -0,0 +1,241 @@
+"""Typed decoding of TOML documents into dataclasses, TypedDicts and builtins."""
+
+import collections.abc
+import dataclasses
+import datetime
+import math
+import os
+import types
+import typing
+from typing import Any, Dict, Optional, Tuple, Type, Union
+
+from . import _impl
+
+try:
+    from typing import Annotated
+except ImportError:  # python < 3.9
+    try:
+        from typing_extensions import Annotated
+    except ImportError:
+        Annotated = None
+
+_UNION_TYPES = (Union, getattr(types, "UnionType", Union))  # X | Y is 3.10+
+_REQUIRED_WRAPPERS = tuple(w for w in (getattr(typing, "Required", None), getattr(typing, "NotRequired", None)) if w)
+_INT64_MIN = -(2 ** 63)
+_INT64_MAX = 2 ** 63 - 1
+_MISSING = dataclasses.MISSING
+
+
+class Range:
+    """Inclusive bounds for an ``int`` or ``float``, used as ``Annotated[int, Range(1, 65535)]``.
+
+    Args:
+        min (Optional[float]): lowest accepted value, None for no bound
+        max (Optional[float]): highest accepted value, None for no bound
+    """
+
+    def __init__(self, min: Optional[float] = None, max: Optional[float] = None):
+        self.min = min
+        self.max = max
+
+    def __repr__(self) -> str:
+        return f"Range(min={self.min!r}, max={self.max!r})"
+
+
+def _type_hints(tp: Any) -> Dict[str, Any]:
+    try:
+        return typing.get_type_hints(tp, include_extras=True)
+    except TypeError:  # python < 3.9 has no include_extras
+        return typing.get_type_hints(tp)
+
+
+def _is_typeddict(tp: Any) -> bool:
+    return isinstance(tp, type) and issubclass(tp, dict) and hasattr(tp, "__total__")
+
+
+def _union_args(tp: Any) -> Optional[Tuple[Any, ...]]:
+    if typing.get_origin(tp) in _UNION_TYPES:
+        return typing.get_args(tp)
+    return None
+
+
+def _is_optional(tp: Any) -> bool:
+    args = _union_args(tp)
+    return args is not None and type(None) in args
+
+
+def _number_spec(tp: Any, bounds: Optional[Range]) -> tuple:
+    low = bounds.min if bounds else None
+    high = bounds.max if bounds else None
+    if tp is int:
+        low = None if low is None else max(math.ceil(low), _INT64_MIN)
+        high = None if high is None else min(math.floor(high), _INT64_MAX)
+        return ("int", low, high)
+    return ("float", None if low is None else float(low), None if high is None else float(high))
+
+
+class _Compiler:
+    def __init__(self, extra: str):
+        if extra not in ("forbid", "ignore"):
+            raise ValueError(f"extra must be 'forbid' or 'ignore', not {extra!r}")
+        self._forbid_extra = extra == "forbid"
+        self._active = set()  # classes being compiled, to reject recursion
+
+    def compile(self, tp: Any) -> tuple:
+        if tp is Any or tp is object:
+            return ("any",)
+        if Annotated is not None and typing.get_origin(tp) is Annotated:
+            base, *metadata = typing.get_args(tp)
+            bounds = [m for m in metadata if isinstance(m, Range)]
+            if not bounds:
+                return self.compile(base)
+            if base not in (int, float):
+                raise TypeError(f"Range only applies to int and float, not {base!r}")
+            return _number_spec(base, bounds[-1])
+        if tp is bool:
+            return ("bool",)
+        if tp in (int, float):
+            return _number_spec(tp, None)
+        if tp is str:
+            return ("str",)
+        if tp is datetime.datetime:
+            return ("datetime",)
+        if tp is datetime.date:
+            return ("date",)
+        if tp is datetime.time:
+            return ("time",)
+
+        union = _union_args(tp)
+        if union is not None:
+            options = [self.compile(arg) for arg in union if arg is not type(None)]
+            return options[0] if len(options) == 1 else ("union", options)
+
+        origin = typing.get_origin(tp)
+        args = typing.get_args(tp)
+        if origin in (list, collections.abc.Sequence):
+            return ("list", self.compile(args[0]) if args else ("any",))
+        if origin in (dict, collections.abc.Mapping):
+            if args and args[0] is not str:
+                raise TypeError(f"TOML table keys are strings, cannot decode into {tp!r}")
+            return ("dict", self.compile(args[1]) if args else ("any",))
+        if tp in (list, dict):
+            return ("list" if tp is list else "dict", ("any",))
+
+        if dataclasses.is_dataclass(tp) and isinstance(tp, type):
+            return self._object(tp, tp, self._dataclass_fields(tp))
+        if _is_typeddict(tp):
+            return self._object(tp, None, self._typeddict_fields(tp))
+        raise TypeError(f"unsupported schema type {tp!r}")
+
+    def _object(self, tp: type, factory: Optional[type], fields) -> tuple:
+        if tp in self._active:
+            raise TypeError(f"recursive schema types are not supported: {tp.__qualname__}")
+        self._active.add(tp)
+        try:
+            compiled = [(key, name, self.compile(hint), missing) for key, name, hint, missing in fields]
+        finally:
+            self._active.discard(tp)
+        return ("object", factory, self._forbid_extra, tp.__qualname__, compiled)
+
+    @staticmethod
+    def _dataclass_fields(tp: type):
+        hints = _type_hints(tp)
+        for field in dataclasses.fields(tp):
+            if not field.init:
+                continue
+            hint = hints.get(field.name, Any)
+            if field.default is not _MISSING or field.default_factory is not _MISSING:
+                missing = "omit"
+            elif _is_optional(hint):
+                missing = "none"
+            else:
+                missing = "required"
+            yield field.metadata.get("toml", field.name), field.name, hint, missing
+
+    @staticmethod
+    def _typeddict_fields(tp: type):
+        hints = _type_hints(tp)
+        required = getattr(tp, "__required_keys__", frozenset(hints) if tp.__total__ else frozenset())
+        for name, hint in hints.items():
+            # Required/NotRequired (3.11+) are already reflected in __required_keys__
+            if typing.get_origin(hint) in _REQUIRED_WRAPPERS:
+                hint = typing.get_args(hint)[0]
+            yield name, name, hint, "required" if name in required else "omit"
+
+
+class Schema:
+    """A type compiled once into a native decoding plan for ``loads_as``/``load_as``.
+
+    Supported types are ``bool``, ``int``, ``float``, ``str``, ``datetime.date``/``time``/``datetime``,
+    ``list[T]``, ``dict[str, T]``, ``Optional``/``Union``, ``Any``, ``Annotated[int | float, Range(...)]``,
+    dataclasses and TypedDicts (which may nest). A dataclass field can read a different TOML key
+    with ``field(metadata={"toml": "key-name"})``.
+
+    Args:
+        tp (type): the type documents are decoded into
+        extra (str, optional): "forbid" raises ``SchemaError`` for keys that no field declares,
+            "ignore" skips them. Defaults to "forbid".
+    """
+
+    def __init__(self, tp: Any, extra: str = "forbid"):
+        self.type = tp
+        self.extra = extra
+        self._plan = _impl.SchemaPlan(_Compiler(extra).compile(tp))
+
+    def __repr__(self) -> str:
+        return f"Schema({self._plan.description}, extra={self.extra!r})"
+
+
+_schemas: Dict[Any, Schema] = {}
+
+
+def _schema_for(schema: Any) -> Schema:
+    if isinstance(schema, Schema):
+        return schema
+    try:
+        return _schemas[schema]
+    except KeyError:
+        pass
+    except TypeError:  # unhashable, compile every time
+        return Schema(schema)
+    compiled = _schemas[schema] = Schema(schema)
+    return compiled
+
+
+T = typing.TypeVar("T")
+
+
+def loads_as(data: Union[str, bytes], schema: Union[Type[T], Schema]) -> T:
+    """Deserialise a TOML string straight into typed objects.
+
+    The document is parsed with the GIL released and then decoded along the
+    schema's native plan, without building an intermediate dict.
+
+    Args:
+        data (Union[str, bytes]): TOML string, bytes must be UTF-8
+        schema (Union[type, Schema]): target type or a precompiled ``Schema``; types are
+            compiled on first use and cached
+
+    Raises:
+        SchemaError: the document does not match the schema, with the position of the offending value
+
+    Returns:
+        the decoded object
+    """
+    return _impl.loads_as(data, _schema_for(schema)._plan)
+
+
+def load_as(fl: Union[str, bytes, os.PathLike, typing.IO], schema: Union[Type[T], Schema]) -> T:
+    """Deserialise a TOML file straight into typed objects, see ``loads_as``.
+
+    Args:
+        fl (FilePathOrObject): file like object or path; paths are read as UTF-8
+        schema (Union[type, Schema]): target type or a precompiled ``Schema``
+
+    Returns:
+        the decoded object
+    """
+    plan = _schema_for(schema)._plan
+    if hasattr(fl, "read"):
+        return _impl.loads_as(fl.read(), plan)
+    return _impl.load_file_as(os.fsencode(fl), plan)
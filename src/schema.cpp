@@ -0,0 +1,364 @@
+#include <pytomlpp/pytomlpp.hpp>
+#include <pytomlpp/io.hpp>
+#include <pytomlpp/profiling.hpp>
+#include <limits>
+#include <vector>
+
+PYTOMLPP_PUSH_OPTIMIZATIONS;
+
+namespace {
+enum class missing_policy { required, omit, none };
+
+struct field_plan {
+  std::string key;
+  py::object name; // keyword argument (dataclass) or dict key (TypedDict)
+  missing_policy missing;
+};
+
+// Decoding plan compiled from the spec tuples built by pytomlpp._schema.
+struct plan {
+  enum class kind {
+    any,
+    boolean,
+    integer,
+    floating,
+    string,
+    date,
+    time,
+    date_time,
+    list,
+    mapping,
+    object,
+    one_of
+  } type = kind::any;
+  std::string description;
+  // inclusive bounds of integer and floating
+  int64_t int_min = std::numeric_limits<int64_t>::min();
+  int64_t int_max = std::numeric_limits<int64_t>::max();
+  double float_min = -std::numeric_limits<double>::infinity();
+  double float_max = std::numeric_limits<double>::infinity();
+  // list and mapping: the item plan; one_of: the alternatives; object: one
+  // plan per field
+  std::vector<plan> children;
+  std::vector<field_plan> fields;
+  py::object factory; // object: called with the fields as keywords, or None
+  bool forbid_extra = true;
+};
+
+plan compile_plan(py::handle spec) {
+  const auto items = py::reinterpret_borrow<py::tuple>(spec);
+  const auto tag = items[0].cast<std::string>();
+  plan p;
+  p.description = tag;
+  if (tag == "any") {
+    p.type = plan::kind::any;
+  } else if (tag == "bool") {
+    p.type = plan::kind::boolean;
+  } else if (tag == "int") {
+    p.type = plan::kind::integer;
+    if (!items[1].is_none())
+      p.int_min = items[1].cast<int64_t>();
+    if (!items[2].is_none())
+      p.int_max = items[2].cast<int64_t>();
+  } else if (tag == "float") {
+    p.type = plan::kind::floating;
+    if (!items[1].is_none())
+      p.float_min = items[1].cast<double>();
+    if (!items[2].is_none())
+      p.float_max = items[2].cast<double>();
+  } else if (tag == "str") {
+    p.type = plan::kind::string;
+  } else if (tag == "date") {
+    p.type = plan::kind::date;
+  } else if (tag == "time") {
+    p.type = plan::kind::time;
+  } else if (tag == "datetime") {
+    p.type = plan::kind::date_time;
+  } else if (tag == "list" || tag == "dict") {
+    p.type = tag == "list" ? plan::kind::list : plan::kind::mapping;
+    p.children.push_back(compile_plan(items[1]));
+    p.description += "[" + p.children[0].description + "]";
+  } else if (tag == "union") {
+    p.type = plan::kind::one_of;
+    p.description.clear();
+    for (auto &&option : items[1]) {
+      p.children.push_back(compile_plan(option));
+      if (!p.description.empty())
+        p.description += " | ";
+      p.description += p.children.back().description;
+    }
+  } else if (tag == "object") {
+    // ("object", factory or None, forbid_extra, name, fields)
+    p.type = plan::kind::object;
+    p.factory = py::reinterpret_borrow<py::object>(items[1]);
+    p.forbid_extra = items[2].cast<bool>();
+    p.description = items[3].cast<std::string>();
+    for (auto &&field : items[4]) {
+      // (toml key, attribute name, spec, missing policy)
+      const auto parts = py::reinterpret_borrow<py::tuple>(field);
+      const auto missing = parts[3].cast<std::string>();
+      PyObject *name = parts[1].ptr();
+      Py_INCREF(name);
+      PyUnicode_InternInPlace(&name);
+      p.fields.push_back({parts[0].cast<std::string>(),
+                          py::reinterpret_steal<py::object>(name),
+                          missing == "required" ? missing_policy::required
+                          : missing == "none"   ? missing_policy::none
+                                                : missing_policy::omit});
+      p.children.push_back(compile_plan(parts[2]));
+    }
+  } else {
+    throw py::value_error("unknown schema spec '" + tag + "'");
+  }
+  return p;
+}
+
+// Walks a parsed document along a plan, building the target objects directly.
+// Mismatches raise SchemaError carrying the offending node's source region.
+class schema_decoder {
+  std::string path; // key path of the node being decoded, for messages
+
+  [[noreturn]] void fail(const toml::node &node, const std::string &problem) {
+    const auto &source = node.source();
+    std::ostringstream message;
+    message << (path.empty() ? "<document>" : path) << ": " << problem
+            << " (line " << source.begin.line << ", column "
+            << source.begin.column << ")";
+    throw pytomlpp::SchemaError(
+        message.str(), static_cast<int>(source.begin.line),
+        static_cast<int>(source.begin.column),
+        static_cast<int>(source.end.line), static_cast<int>(source.end.column),
+        source.path);
+  }
+
+  [[noreturn]] void mismatch(const toml::node &node, const plan &p) {
+    std::ostringstream problem;
+    problem << "expected " << p.description << ", got " << node.type();
+    fail(node, problem.str());
+  }
+
+  static py::object steal(PyObject *object) {
+    if (!object)
+      throw py::error_already_set();
+    return py::reinterpret_steal<py::object>(object);
+  }
+
+  py::object integer(const toml::node &node, const plan &p) {
+    const auto *value = node.as_integer();
+    if (!value)
+      mismatch(node, p);
+    const int64_t v = value->get();
+    if (v < p.int_min || v > p.int_max)
+      fail(node, "value " + std::to_string(v) + " is out of range [" +
+                     std::to_string(p.int_min) + ", " +
+                     std::to_string(p.int_max) + "]");
+    return steal(PyLong_FromLongLong(v));
+  }
+
+  py::object floating(const toml::node &node, const plan &p) {
+    double v;
+    if (const auto *value = node.as_floating_point())
+      v = value->get();
+    else if (const auto *int_value = node.as_integer())
+      v = static_cast<double>(int_value->get());
+    else
+      mismatch(node, p);
+    if (v < p.float_min || v > p.float_max) {
+      std::ostringstream problem;
+      problem << "value " << v << " is out of range [" << p.float_min << ", "
+              << p.float_max << "]";
+      fail(node, problem.str());
+    }
+    return steal(PyFloat_FromDouble(v));
+  }
+
+  py::list list(const toml::node &node, const plan &p) {
+    const auto *array = node.as_array();
+    if (!array)
+      mismatch(node, p);
+    py::list result(array->size());
+    const size_t mark = path.size();
+    for (size_t i = 0; i < array->size(); i++) {
+      path += "[" + std::to_string(i) + "]";
+      PyList_SET_ITEM(result.ptr(), static_cast<Py_ssize_t>(i),
+                      decode((*array)[i], p.children[0]).release().ptr());
+      path.resize(mark);
+    }
+    return result;
+  }
+
+  void push_key(std::string_view key) {
+    if (!path.empty())
+      path += '.';
+    path += key;
+  }
+
+  py::dict mapping(const toml::node &node, const plan &p) {
+    const auto *table = node.as_table();
+    if (!table)
+      mismatch(node, p);
+    py::dict result;
+    const size_t mark = path.size();
+    for (auto &&kvp : *table) {
+      push_key(kvp.first.str());
+      py::object value = decode(kvp.second, p.children[0]);
+      path.resize(mark);
+      result[py::str(kvp.first.str())] = std::move(value);
+    }
+    return result;
+  }
+
+  py::object object(const toml::node &node, const plan &p) {
+    const auto *table = node.as_table();
+    if (!table)
+      mismatch(node, p);
+    py::dict kwargs;
+    const size_t mark = path.size();
+    size_t found = 0;
+    for (size_t i = 0; i < p.fields.size(); i++) {
+      const field_plan &field = p.fields[i];
+      const toml::node *value = table->get(field.key);
+      if (!value) {
+        if (field.missing == missing_policy::required)
+          fail(node, "missing key '" + field.key + "' of " + p.description);
+        if (field.missing == missing_policy::none)
+          kwargs[field.name] = py::none();
+        continue;
+      }
+      found++;
+      push_key(field.key);
+      py::object item = decode(*value, p.children[i]);
+      path.resize(mark);
+      if (PyDict_SetItem(kwargs.ptr(), field.name.ptr(), item.ptr()))
+        throw py::error_already_set();
+    }
+    if (p.forbid_extra && found < table->size())
+      unknown_key(*table, p);
+    if (p.factory.is_none())
+      return std::move(kwargs);
+    return steal(PyObject_Call(p.factory.ptr(), py::tuple().ptr(),
+                               kwargs.ptr()));
+  }
+
+  [[noreturn]] void unknown_key(const toml::table &table, const plan &p) {
+    for (auto &&kvp : table) {
+      bool known = false;
+      for (auto &field : p.fields)
+        known = known || field.key == kvp.first.str();
+      if (!known) {
+        push_key(kvp.first.str());
+        fail(kvp.second, "unknown key for " + p.description);
+      }
+    }
+    throw std::logic_error("schema: no unknown key found");
+  }
+
+  py::object one_of(const toml::node &node, const plan &p) {
+    const size_t mark = path.size();
+    for (auto &option : p.children) {
+      try {
+        return decode(node, option);
+      } catch (const pytomlpp::SchemaError &) {
+        path.resize(mark);
+      }
+    }
+    mismatch(node, p);
+  }
+
+  template <typename T>
+  py::object scalar(const toml::node &node, const plan &p) {
+    const auto *value = node.as<T>();
+    if (!value)
+      mismatch(node, p);
+    return py::cast(value->get());
+  }
+
+public:
+  py::object decode(const toml::node &node, const plan &p) {
+    switch (p.type) {
+    case plan::kind::any:
+      return pytomlpp::toml_node_to_py(node);
+    case plan::kind::boolean:
+      if (const auto *value = node.as_boolean())
+        return py::bool_(value->get());
+      mismatch(node, p);
+    case plan::kind::integer:
+      return integer(node, p);
+    case plan::kind::floating:
+      return floating(node, p);
+    case plan::kind::string:
+      if (const auto *value = node.as_string())
+        return steal(PyUnicode_FromStringAndSize(
+            value->get().data(), static_cast<Py_ssize_t>(value->get().size())));
+      mismatch(node, p);
+    case plan::kind::date:
+      return scalar<toml::date>(node, p);
+    case plan::kind::time:
+      return scalar<toml::time>(node, p);
+    case plan::kind::date_time:
+      return scalar<toml::date_time>(node, p);
+    case plan::kind::list:
+      return list(node, p);
+    case plan::kind::mapping:
+      return mapping(node, p);
+    case plan::kind::object:
+      return object(node, p);
+    case plan::kind::one_of:
+      return one_of(node, p);
+    }
+    throw std::logic_error("schema: unhandled plan kind");
+  }
+};
+
+py::object decode_table(const toml::table &table, const plan &p) {
+  PROFILE_SCOPE("loads_as.decode");
+  return schema_decoder{}.decode(table, p);
+}
+
+py::object loads_as(const py::object &document, const plan &p) {
+  const std::string_view text = pytomlpp::document_view(document);
+  pytomlpp::profiling::add(pytomlpp::profiling::counter::bytes_in,
+                           text.size());
+  toml::table table;
+  try {
+    PROFILE_SCOPE("loads_as.parse");
+    py::gil_scoped_release release;
+    table = toml::parse(text);
+  } catch (const toml::parse_error &e) {
+    pytomlpp::throw_decode_error(e);
+  }
+  return decode_table(table, p);
+}
+
+py::object load_file_as(const std::string &path, const plan &p) {
+  toml::table table;
+  int error_code = 0;
+  try {
+    PROFILE_SCOPE("loads_as.parse");
+    py::gil_scoped_release release;
+    pytomlpp::file_contents file{path};
+    error_code = file.error();
+    if (!error_code) {
+      pytomlpp::profiling::add(pytomlpp::profiling::counter::bytes_in,
+                               file.view().size());
+      table = toml::parse(file.view(), std::string_view{path});
+    }
+  } catch (const toml::parse_error &e) {
+    pytomlpp::throw_decode_error(e);
+  }
+  if (error_code)
+    pytomlpp::throw_os_error(error_code, path);
+  return decode_table(table, p);
+}
+} // namespace
+
+namespace pytomlpp {
+void register_schema(py::module &m) {
+  py::class_<plan>(m, "SchemaPlan")
+      .def(py::init(&compile_plan), py::arg("spec"))
+      .def_property_readonly(
+          "description", [](const plan &p) { return p.description; });
+  m.def("loads_as", &loads_as, py::arg("data"), py::arg("plan"));
+  m.def("load_file_as", &load_file_as, py::arg("path"), py::arg("plan"));
+}
+} // namespace pytomlpp
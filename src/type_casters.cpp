@@ -1,16 +1,57 @@
 #include <pytomlpp/pytomlpp.hpp>
 #include <datetime.h>
+#include <atomic>
 
 PYTOMLPP_PUSH_OPTIMIZATIONS;
 
 namespace {
-void lazy_init_py_date_time() noexcept {
-  if (PyDateTimeAPI)
-    return;
+pytomlpp::datetime_types types;
+py::handle timezone_class;
+py::handle timedelta_class;
+
+// one datetime.timezone per offset, created on first use and kept for the
+// lifetime of the module; covers every offset toml allows (+/-23:59). Slots
+// are filled with a compare-exchange so concurrent first uses (free-threaded
+// builds) agree on a single object.
+constexpr int max_offset_minutes = 24 * 60 - 1;
+std::atomic<PyObject *> timezone_cache[2 * max_offset_minutes + 1] = {};
+
+py::object timezone_for_offset(int minutes) {
+#ifndef PYPY_VERSION
+  if (minutes == 0)
+    return py::reinterpret_borrow<py::object>(PyDateTime_TimeZone_UTC);
+#endif
+  if (minutes < -max_offset_minutes || minutes > max_offset_minutes)
+    return timezone_class(timedelta_class("minutes"_a = minutes));
+
+  auto &slot = timezone_cache[minutes + max_offset_minutes];
+  PyObject *cached = slot.load(std::memory_order_acquire);
+  if (!cached) {
+    py::object created = timezone_class(timedelta_class("minutes"_a = minutes));
+    if (slot.compare_exchange_strong(cached, created.ptr(),
+                                     std::memory_order_acq_rel))
+      return py::reinterpret_borrow<py::object>(created.release());
+  }
+  return py::reinterpret_borrow<py::object>(cached);
+}
+} // namespace
 
+namespace pytomlpp {
+void import_datetime() {
   PyDateTime_IMPORT;
+  if (!PyDateTimeAPI)
+    throw py::error_already_set();
+  types.date = PyDateTimeAPI->DateType;
+  types.time = PyDateTimeAPI->TimeType;
+  types.datetime = PyDateTimeAPI->DateTimeType;
+
+  auto datetime_module = py::module::import("datetime");
+  timezone_class = datetime_module.attr("timezone").release();
+  timedelta_class = datetime_module.attr("timedelta").release();
 }
-} // namespace
+
+const datetime_types &py_datetime_types() noexcept { return types; }
+} // namespace pytomlpp
 
 namespace pybind11::detail {
 // python date -> toml date
@@ -18,7 +59,6 @@ bool type_caster<toml::date>::load(handle src, bool) {
   if (!src)
     return false;
 
-  lazy_init_py_date_time();
   toml::date d;
 
   if (PyDate_Check(src.ptr())) {
@@ -36,7 +76,6 @@ bool type_caster<toml::date>::load(handle src, bool) {
 handle type_caster<toml::date>::cast(const toml::date &src,
                                      return_value_policy /* policy */,
                                      handle /* parent */) {
-  lazy_init_py_date_time();
   return PyDate_FromDate(src.year, src.month, src.day);
 }
 
@@ -45,7 +84,6 @@ bool type_caster<toml::time>::load(handle src, bool) {
   if (!src)
     return false;
 
-  lazy_init_py_date_time();
   toml::time t;
 
   if (PyTime_Check(src.ptr())) {
@@ -64,7 +102,6 @@ bool type_caster<toml::time>::load(handle src, bool) {
 handle type_caster<toml::time>::cast(const toml::time &src,
                                      return_value_policy /* policy */,
                                      handle /* parent */) {
-  lazy_init_py_date_time();
   return PyTime_FromTime(src.hour, src.minute, src.second,
                          src.nanosecond / 1000);
 }
@@ -73,7 +110,6 @@ bool type_caster<toml::date_time>::load(handle src, bool) {
   if (!src)
     return false;
 
-  lazy_init_py_date_time();
   toml::date_time dt;
 
   if (PyDateTime_Check(src.ptr())) {
@@ -91,13 +127,15 @@ bool type_caster<toml::date_time>::load(handle src, bool) {
     py::object tz_info = src.attr("tzinfo");
 
     if (!tz_info.is_none()) {
-      toml::time_offset to;
       py::object time_delta = tz_info.attr("utcoffset")(src);
-      py::object total_seconds_object = time_delta.attr("total_seconds")();
-      int total_seconds = total_seconds_object.cast<py::int_>();
-      int total_minutes = total_seconds / 60;
-      to.minutes = total_minutes;
-      dt.offset = to;
+      if (PyDelta_Check(time_delta.ptr())) {
+        const int total_seconds =
+            PyDateTime_DELTA_GET_DAYS(time_delta.ptr()) * 24 * 60 * 60 +
+            PyDateTime_DELTA_GET_SECONDS(time_delta.ptr());
+        toml::time_offset to;
+        to.minutes = static_cast<int16_t>(total_seconds / 60);
+        dt.offset = to;
+      }
     }
 
     dt.date = d;
@@ -112,15 +150,10 @@ bool type_caster<toml::date_time>::load(handle src, bool) {
 handle type_caster<toml::date_time>::cast(const toml::date_time &src,
                                           return_value_policy /* policy */,
                                           handle /* parent */) {
-  lazy_init_py_date_time();
-  auto datetime_module = py::module::import("datetime");
   py::object timezone_obj = py::none();
 
-  if (src.offset) {
-    auto minutes = src.offset.value().minutes;
-    auto delta = datetime_module.attr("timedelta")("minutes"_a = minutes);
-    timezone_obj = datetime_module.attr("timezone")(delta);
-  }
+  if (src.offset)
+    timezone_obj = timezone_for_offset(src.offset.value().minutes);
 
   return PyDateTimeAPI->DateTime_FromDateAndTime(
       src.date.year, src.date.month, src.date.day, src.time.hour,
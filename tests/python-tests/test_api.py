@@ -2,7 +2,19 @@ from __future__ import print_function
 
 import pytest
 
+import array
+import collections.abc
+import concurrent.futures
+import dataclasses
+import datetime
+import enum
+import io
 import json
+import math
+import os
+import sys
+import types
+import typing
 
 try:
     import pathlib
@@ -125,3 +137,677 @@ def test_decode_encode_binary(toml_file, tmp_path):
     data = pytomlpp.load(toml_file)
     pytomlpp.dump(data, str(tmp_path / "tmp.toml"), mode="wb")
     assert pytomlpp.load(str(tmp_path / "tmp.toml"), mode="rb") == data
+
+def test_loads_many():
+    documents = ['a = 1', b'b = "two"', '[c]\nd = [1, 2]']
+    assert pytomlpp.loads_many(documents) == [
+        {'a': 1}, {'b': 'two'}, {'c': {'d': [1, 2]}}
+    ]
+    assert pytomlpp.loads_many(documents, threads=1) == pytomlpp.loads_many(documents)
+    assert pytomlpp.loads_many([]) == []
+
+@pytest.mark.parametrize("toml_file", valid_toml_files)
+def test_loads_many_matches_loads(toml_file):
+    text = toml_file.read_text(encoding="utf-8")
+    assert pytomlpp.loads_many([text] * 4) == [pytomlpp.loads(text)] * 4
+
+def test_loads_many_invalid():
+    with pytest.raises(pytomlpp.DecodeError):
+        pytomlpp.loads_many(['a = 1', 'a = ', 'b = 2'])
+    with pytest.raises(TypeError):
+        pytomlpp.loads_many(['a = 1', 3])
+
+def test_decode_error_attributes(tmp_path):
+    with pytest.raises(pytomlpp.DecodeError) as info:
+        pytomlpp.loads('a = 1\nb = ')
+    assert info.value.start_line == 2
+    assert info.value.path is None
+
+    toml_file = tmp_path / "broken.toml"
+    toml_file.write_text('a = 1\nb = ', encoding="utf-8")
+    with pytest.raises(pytomlpp.DecodeError) as info:
+        pytomlpp.load(toml_file)
+    assert info.value.start_line == 2
+    assert info.value.path == str(toml_file)
+
+def test_load_file_variants(tmp_path):
+    toml_file = tmp_path / "data.toml"
+    toml_file.write_bytes('hello = "世界"\n'.encode("utf-8"))
+    expected = {'hello': '世界'}
+    assert pytomlpp.load(toml_file) == expected
+    assert pytomlpp.load(str(toml_file), mode="rb") == expected
+    assert pytomlpp.load(bytes(toml_file)) == expected
+    with open(toml_file, "rb") as f:
+        assert pytomlpp.load(f) == expected
+    assert pytomlpp.loads(toml_file.read_bytes()) == expected
+
+    empty_file = tmp_path / "empty.toml"
+    empty_file.write_bytes(b"")
+    assert pytomlpp.load(empty_file) == {}
+
+    with pytest.raises(FileNotFoundError):
+        pytomlpp.load(tmp_path / "missing.toml")
+
+def test_loads_lazy():
+    text = '[server]\nhost = "localhost"\nport = 8080\n[[servers]]\nname = "a"\n[[servers]]\nname = "b"\n'
+    table = pytomlpp.loads(text, lazy=True)
+    assert isinstance(table, pytomlpp.TomlTable)
+    assert isinstance(table, collections.abc.Mapping)
+    assert len(table) == 2
+    assert sorted(table) == ['server', 'servers']
+    assert table['server']['port'] == 8080
+    assert table['server'] is table['server']
+    assert table['servers'][1]['name'] == 'b'
+    # arrays are not cached, changing one leaves the view untouched
+    table['servers'].append('extra')
+    assert len(table['servers']) == 2
+    assert table.get('missing') is None
+    assert 'server' in table and 'missing' not in table and 1 not in table
+    with pytest.raises(KeyError):
+        table['missing']
+    assert table == pytomlpp.loads(text)
+    assert table.to_dict() == pytomlpp.loads(text)
+    assert dict(table['server'].items()) == {'host': 'localhost', 'port': 8080}
+
+@pytest.mark.parametrize("toml_file", valid_toml_files)
+def test_load_lazy_matches_load(toml_file):
+    assert pytomlpp.load(toml_file, lazy=True) == pytomlpp.load(toml_file)
+
+def test_loads_paths(tmp_path):
+    text = '[server]\nport = 8080\n[database.pool]\nsize = 4\n[[x]]\ny = [1, 2, 3, 4]\n'
+    paths = ["server.port", "database.pool", "x[0].y[3]", "missing.key", "x[5]"]
+    expected = {"server.port": 8080, "database.pool": {"size": 4}, "x[0].y[3]": 4}
+    assert pytomlpp.loads_paths(text, paths) == expected
+
+    toml_file = tmp_path / "data.toml"
+    toml_file.write_text(text, encoding="utf-8")
+    assert pytomlpp.load_paths(toml_file, paths) == expected
+    with open(toml_file, "r") as f:
+        assert pytomlpp.load_paths(f, iter(paths)) == expected
+
+    with pytest.raises(pytomlpp.DecodeError):
+        pytomlpp.loads_paths("a = ", ["a"])
+
+def _fnv1a(data):
+    value = 0xcbf29ce484222325
+    for byte in data:
+        value = ((value ^ byte) * 0x100000001b3) & 0xFFFFFFFFFFFFFFFF
+    return value
+
+def test_dumps_canonical_and_hash():
+    utc = datetime.timezone.utc
+    plus_two = datetime.timezone(datetime.timedelta(hours=2))
+    minus_half = datetime.timezone(datetime.timedelta(minutes=-30))
+    first = {'b': -0.0, 'a': datetime.datetime(2024, 1, 1, 1, 30, tzinfo=plus_two), 'c': [float('-nan')]}
+    second = {'a': datetime.datetime(2023, 12, 31, 23, 30, tzinfo=utc), 'c': [float('nan')], 'b': 0.0}
+    assert pytomlpp.dumps(first) != pytomlpp.dumps(second)
+    assert pytomlpp.dumps(first, canonical=True) == pytomlpp.dumps(second, canonical=True)
+    table = pytomlpp.loads(pytomlpp.dumps(first, canonical=True))
+    assert table['a'] == first['a'] and table['a'].utcoffset() == datetime.timedelta(0)
+    assert math.copysign(1.0, table['b']) == 1.0
+    leap = {'t': datetime.datetime(2024, 3, 1, 0, 10, tzinfo=minus_half)}
+    assert pytomlpp.loads(pytomlpp.dumps(leap, canonical=True))['t'] == leap['t']
+    local = {'t': datetime.datetime(2024, 3, 1, 0, 10)}
+    assert pytomlpp.dumps(local, canonical=True) == pytomlpp.dumps(local)
+    for edge in (datetime.datetime(1, 1, 1, 0, 30, tzinfo=plus_two),
+                 datetime.datetime(9999, 12, 31, 23, 45, tzinfo=minus_half)):
+        pytomlpp.dumps({'t': edge})
+        with pytest.raises(ValueError):
+            pytomlpp.dumps({'t': edge}, canonical=True)
+    first_day = datetime.datetime(1, 1, 1, 2, 30, tzinfo=plus_two)
+    assert pytomlpp.loads(pytomlpp.dumps({'t': first_day}, canonical=True))['t'] == first_day
+
+    text, digest = pytomlpp.dumps(first, canonical=True, return_hash=True)
+    assert digest == _fnv1a(text.encode("utf-8"))
+    data = {'big': 'x' * 100000, 'k': '世界'}
+    raw, raw_digest = pytomlpp.dumps_bytes(data, return_hash=True)
+    assert raw == pytomlpp.dumps_bytes(data) and raw_digest == _fnv1a(raw)
+    assert pytomlpp.dumps(dict(reversed(list(data.items()))), return_hash=True)[1] == raw_digest
+
+def test_dumps_many():
+    data = [{'a': i, 'b': {'c': [i, i + 1]}, 'd': '世界'} for i in range(50)]
+    assert pytomlpp.dumps_many(data) == [pytomlpp.dumps(d) for d in data]
+    assert pytomlpp.dumps_many(iter(data), threads=1, binary=True) == [pytomlpp.dumps_bytes(d) for d in data]
+    assert pytomlpp.dumps_many([]) == []
+    with pytest.raises(TypeError):
+        pytomlpp.dumps_many([{'a': 1}, {'b': object()}])
+
+def test_dumps_bytes_and_dump_to(tmp_path):
+    data = {'a': 1, 'b': {'c': '世界', 'd': [1.5, 2.5]}, 'e': 'x' * 200000}
+    text = pytomlpp.dumps(data)
+    assert pytomlpp.dumps_bytes(data) == text.encode("utf-8")
+
+    toml_file = tmp_path / "out.toml"
+    pytomlpp.dump(data, toml_file)
+    assert toml_file.read_bytes() == text.encode("utf-8")
+    pytomlpp.dump(data, str(toml_file), mode="wb")
+    assert toml_file.read_bytes() == text.encode("utf-8")
+
+    buffer = io.BytesIO()
+    pytomlpp.dump(data, buffer, mode="wb")
+    assert buffer.getvalue() == text.encode("utf-8")
+
+    with open(toml_file, "wb") as f:
+        pytomlpp._impl.dump_to(data, f.fileno())
+    assert pytomlpp.load(toml_file) == data
+
+    with pytest.raises(OSError):
+        pytomlpp.dump(data, tmp_path / "missing" / "out.toml", mode="wb")
+    with pytest.raises(TypeError):
+        pytomlpp._impl.dump_to(data, 1.5)
+    with pytest.raises(TypeError):
+        pytomlpp._impl.dump_to(data, True)
+
+@pytest.mark.parametrize("toml_file", valid_toml_files)
+def test_dumps_output_is_stable(toml_file):
+    text = pytomlpp.dumps(pytomlpp.load(toml_file))
+    assert pytomlpp.dumps(pytomlpp.loads(text)) == text
+    assert pytomlpp.dumps_bytes(pytomlpp.loads(text)) == text.encode("utf-8")
+
+def test_offset_datetimes():
+    table = pytomlpp.loads(
+        'a = 1979-05-27T07:32:00Z\n'
+        'b = 1979-05-27T07:32:00-07:30\n'
+        'c = 1979-05-27T07:32:00-07:30\n'
+        'd = 1979-05-27T07:32:00+23:59\n'
+        'e = 1979-05-27T07:32:00\n'
+    )
+    assert table['a'].tzinfo is datetime.timezone.utc
+    assert table['b'].utcoffset() == -datetime.timedelta(hours=7, minutes=30)
+    assert table['b'].tzinfo is table['c'].tzinfo
+    assert table['d'].utcoffset() == datetime.timedelta(hours=23, minutes=59)
+    assert table['e'].tzinfo is None
+    assert pytomlpp.loads(pytomlpp.dumps(table)) == table
+
+def test_dumps_mappings_and_sequences():
+    class Flag(enum.IntEnum):
+        ON = 1
+
+    class Name(str):
+        pass
+
+    class Numbers(collections.abc.Sequence):
+        def __getitem__(self, index):
+            return [1, 2, 3][index]
+
+        def __len__(self):
+            return 3
+
+    data = types.MappingProxyType({
+        'bools': [True, False],
+        'tuple': (1, 2.5, 'x'),
+        'flag': Flag.ON,
+        'name': Name('n'),
+        'proxy': types.MappingProxyType({'a': 1}),
+        'numbers': Numbers(),
+        'ordered': collections.OrderedDict(b=2),
+    })
+    assert pytomlpp.loads(pytomlpp.dumps(data)) == {
+        'bools': [True, False],
+        'tuple': [1, 2.5, 'x'],
+        'flag': 1,
+        'name': 'n',
+        'proxy': {'a': 1},
+        'numbers': [1, 2, 3],
+        'ordered': {'b': 2},
+    }
+
+def test_dumps_invalid_values():
+    with pytest.raises(TypeError):
+        pytomlpp.dumps({'a': 2 ** 63})
+    with pytest.raises(TypeError):
+        pytomlpp.dumps({'a': b'bytes'})
+    with pytest.raises(TypeError):
+        pytomlpp.dumps({1: 'a'})
+    with pytest.raises(TypeError):
+        pytomlpp.dumps([1, 2])
+
+def test_loads_large_document():
+    data = {
+        'items': [{'id': i, 'name': f'item {i}', 'price': i / 4, 'flag': i % 2 == 0,
+                   'tags': ['a', 'b'], 'when': datetime.date(2020, 1, i % 28 + 1)}
+                  for i in range(20000)],
+        'wide': {f'key_{i}': i for i in range(20000)},
+    }
+    assert pytomlpp.loads(pytomlpp.dumps(data)) == data
+
+def test_loads_homogeneous_arrays_as_buffers(tmp_path):
+    text = 'ints = [1, -2, 3]\nfloats = [0.5, 2.0]\nmixed = [1, 2.5]\nempty = []\n[t]\nnested = [[1, 2], [3]]\n'
+    table = pytomlpp.loads(text, homogeneous_arrays="buffer")
+    assert isinstance(table['ints'], array.array) and table['ints'].typecode == 'q'
+    assert table['ints'].tolist() == [1, -2, 3]
+    assert isinstance(table['floats'], array.array) and table['floats'].typecode == 'd'
+    assert table['floats'].tolist() == [0.5, 2.0]
+    assert table['mixed'] == [1, 2.5]
+    assert table['empty'] == []
+    assert [a.tolist() for a in table['t']['nested']] == [[1, 2], [3]]
+    toml_file = tmp_path / "arrays.toml"
+    toml_file.write_text(text, encoding="utf-8")
+    assert pytomlpp.load(toml_file, homogeneous_arrays="buffer")['ints'].typecode == 'q'
+    assert pytomlpp.loads(text)['ints'] == [1, -2, 3]
+    with pytest.raises(ValueError):
+        pytomlpp.loads(text, homogeneous_arrays="tuple")
+    with pytest.raises(ValueError):
+        pytomlpp.loads(text, lazy=True, homogeneous_arrays="buffer")
+
+def test_dumps_buffers():
+    data = {
+        'q': array.array('q', [1, -2, 2 ** 62]),
+        'f': array.array('f', [0.5, 1.5]),
+        'strided': memoryview(array.array('i', [1, 2, 3, 4, 5]))[::2],
+        'bools': memoryview(b'\x00\x01').cast('?'),
+    }
+    assert pytomlpp.loads(pytomlpp.dumps(data)) == {
+        'q': [1, -2, 2 ** 62], 'f': [0.5, 1.5], 'strided': [1, 3, 5], 'bools': [False, True],
+    }
+    with pytest.raises(TypeError):
+        pytomlpp.dumps({'big': array.array('Q', [2 ** 64 - 1])})
+
+@pytest.mark.skipif(sys.implementation.name != "cpython", reason="relies on object identity")
+def test_loads_reuses_key_strings():
+    table = pytomlpp.loads('[[servers]]\nhost = "a"\n[[servers]]\nhost = "b"\n')
+    first, second = (next(iter(server)) for server in table['servers'])
+    assert first == second == 'host'
+    assert first is second
+
+def test_validate(tmp_path):
+    assert pytomlpp.validate('a = 1') is None
+    error = pytomlpp.validate(b'a = 1\nb = ')
+    assert isinstance(error, pytomlpp.DecodeError)
+    assert error.start_line == 2 and error.path is None
+    good, bad = tmp_path / "good.toml", tmp_path / "bad.toml"
+    good.write_text('a = 1\n', encoding="utf-8")
+    bad.write_text('a = 1\na = 2\n', encoding="utf-8")
+    assert pytomlpp.validate(good) is None
+    results = pytomlpp.validate([good, str(bad), bytes(good)] * 10, threads=4)
+    assert results[::3] == [None] * 10
+    assert all(isinstance(r, pytomlpp.DecodeError) and r.start_line == 2 and r.path == str(bad)
+               for r in results[1::3])
+    # an unreadable path only fails its own slot
+    results = pytomlpp.validate([good, tmp_path / "missing.toml", bad])
+    assert results[0] is None
+    assert isinstance(results[1], FileNotFoundError)
+    assert results[1].filename == str(tmp_path / "missing.toml")
+    assert isinstance(results[2], pytomlpp.DecodeError)
+    with pytest.raises(FileNotFoundError):
+        pytomlpp.validate(tmp_path / "missing.toml")
+
+def test_incremental_parser():
+    text = '[a]\nb = "世界"\nc = [1, 2]\n[[d]]\ne = 1.5\n'.encode("utf-8")
+    parser = pytomlpp.IncrementalParser(size_hint=len(text))
+    for i in range(0, len(text), 3):  # splits multi-byte characters too
+        parser.feed(memoryview(text)[i:i + 3] if i % 2 else bytearray(text[i:i + 3]))
+    parser.feed('f = true\n')
+    assert parser.buffered == len(text) + 9
+    assert parser.close() == {'a': {'b': '世界', 'c': [1, 2]}, 'd': [{'e': 1.5}], 'f': True}
+    assert parser.closed
+    with pytest.raises(ValueError):
+        parser.feed(b'x = 1')
+    lazy = pytomlpp.IncrementalParser()
+    lazy.feed(b'x = 1')
+    assert lazy.close(lazy=True)['x'] == 1
+    broken = pytomlpp.IncrementalParser()
+    broken.feed(b'x = ')
+    with pytest.raises(pytomlpp.DecodeError):
+        broken.close()
+    with pytest.raises(TypeError):
+        pytomlpp.IncrementalParser().feed(1)
+
+def test_document_edit_and_save(tmp_path):
+    toml_file = tmp_path / "project.toml"
+    toml_file.write_text('[project]\nversion = "1.0"\n[[servers]]\nhost = "a"\nports = [1, 2]\n', encoding="utf-8")
+    doc = pytomlpp.Document.load(toml_file)
+    assert doc.path == str(toml_file)
+    assert doc["project.version"] == "1.0"
+    assert doc.get("servers[0].ports[1]") == 2
+    assert doc.get("project.missing", 5) == 5
+    assert "servers[0].host" in doc and "servers[1]" not in doc
+    doc["project.version"] = "1.1"
+    doc.set("servers[0].ports[0]", 10)
+    doc.set("tool.flags.fast", True)
+    del doc["servers[0].host"]
+    if os.name == "posix":
+        os.chmod(toml_file, 0o640)
+    doc.save()
+    assert pytomlpp.load(toml_file) == {
+        'project': {'version': '1.1'},
+        'servers': [{'ports': [10, 2]}],
+        'tool': {'flags': {'fast': True}},
+    }
+    # replaced through a temporary file, which is gone afterwards
+    assert os.listdir(tmp_path) == ["project.toml"]
+    if os.name == "posix":
+        assert toml_file.stat().st_mode & 0o777 == 0o640
+    assert doc.to_dict() == pytomlpp.loads(doc.dumps())
+
+@pytest.mark.skipif(os.name != "posix", reason="symlinks need privileges on windows")
+def test_document_save_through_symlink(tmp_path):
+    real = tmp_path / "real.toml"
+    real.write_text('a = 1\n', encoding="utf-8")
+    link = tmp_path / "link.toml"
+    link.symlink_to(real)
+    doc = pytomlpp.Document.load(link)
+    doc["a"] = 2
+    doc.save()
+    assert link.is_symlink()
+    assert pytomlpp.load(real) == {'a': 2}
+    assert sorted(os.listdir(tmp_path)) == ["link.toml", "real.toml"]
+
+def test_document_errors(tmp_path):
+    doc = pytomlpp.Document('a = 1\nb = [1]\n')
+    assert doc.path is None
+    with pytest.raises(KeyError):
+        doc["c"]
+    with pytest.raises(KeyError):
+        del doc["c"]
+    with pytest.raises(KeyError):
+        doc["a.b"] = 1
+    with pytest.raises(KeyError):
+        doc["b[1]"] = 1
+    # a failed set creates none of the missing tables along the path
+    before = doc.dumps()
+    for path in ("x.y[0]", "x[0].y", "x.y.z[0]", "b.c.d", "a.b"):
+        with pytest.raises(KeyError):
+            doc[path] = 1
+    assert doc.dumps() == before
+    with pytest.raises(ValueError):
+        doc.get("a..b")
+    with pytest.raises(TypeError):
+        doc["a"] = object()
+    with pytest.raises(ValueError):
+        doc.save()
+    with pytest.raises(pytomlpp.DecodeError):
+        pytomlpp.Document('a = ')
+    with pytest.raises(FileNotFoundError):
+        pytomlpp.Document.load(tmp_path / "missing.toml")
+    doc.save(tmp_path / "out.toml")
+    assert pytomlpp.load(tmp_path / "out.toml") == {'a': 1, 'b': [1]}
+
+def test_threads_stress(tmp_path):
+    # hammers shared native state from many threads; on free-threaded builds
+    # these really run in parallel
+    threads = 16
+    data = {
+        'name': 'stress', 'values': list(range(100)), 'nested': {'x': 1.5, 'y': [True, False]},
+        'times': [datetime.datetime(2020, 1, 1, tzinfo=datetime.timezone(datetime.timedelta(minutes=m)))
+                  for m in range(-90, 90, 15)],
+    }
+    text = pytomlpp.dumps(data)
+    toml_file = tmp_path / "stress.toml"
+    toml_file.write_text(text, encoding="utf-8")
+    lazy = pytomlpp.loads(text, lazy=True)
+    loader = pytomlpp.CachedLoader()
+    doc = pytomlpp.Document(text)
+    parser = pytomlpp.IncrementalParser()
+    pytomlpp.enable_profiling()
+    try:
+        def work(i):
+            for n in range(30):
+                assert pytomlpp.loads(text) == data
+                assert pytomlpp.loads(pytomlpp.dumps(data)) == data
+                assert loader.load(toml_file) == data
+                assert lazy['nested']['y'] == [True, False]
+                doc[f'counters.t{i}'] = n
+                assert doc.get('nested.x') == 1.5
+                parser.feed(b'')
+            return [t.tzinfo for t in pytomlpp.loads(text)['times']]
+
+        with concurrent.futures.ThreadPoolExecutor(threads) as pool:
+            zones = list(pool.map(work, range(threads)))
+    finally:
+        pytomlpp.enable_profiling(False)
+    assert all(a is b for tz in zones[1:] for a, b in zip(tz, zones[0]))
+    assert doc.to_dict()['counters'] == {f't{i}': 29 for i in range(threads)}
+    assert pytomlpp.get_stats()['phases']['loads.parse']['count'] >= threads * 30
+    assert parser.close() == {}
+    pytomlpp.reset_stats()
+
+def test_load_file_rewritten_concurrently(tmp_path):
+    # files are read, not mapped: one truncated and rewritten mid-parse may
+    # fail to decode but must never crash the interpreter
+    toml_file = tmp_path / "changing.toml"
+    full = 'a = 1\n' + ''.join(f'k{i} = "{"x" * 50}"\n' for i in range(2000))
+    toml_file.write_text(full, encoding="utf-8")
+    stop = False
+
+    def rewrite():
+        while not stop:
+            with open(toml_file, "r+", encoding="utf-8") as f:
+                f.truncate(10)
+                f.write(full)
+
+    with concurrent.futures.ThreadPoolExecutor(1) as pool:
+        writer = pool.submit(rewrite)
+        try:
+            for _ in range(200):
+                try:
+                    assert pytomlpp.load(toml_file)['a'] == 1
+                except pytomlpp.DecodeError:
+                    pass
+        finally:
+            stop = True
+        writer.result()
+
+def test_dumps_while_mutated():
+    # dumps walks dicts and lists another thread keeps replacing items of;
+    # without per-object locking a free-threaded build reads freed objects
+    shared = {'list': list(range(10)), 'table': {'a': 'x'}}
+    stop = False
+
+    def mutate():
+        i = 0
+        while not stop:
+            shared[f'key{i % 50}'] = [f'value {i}'] * 3
+            shared.pop(f'key{(i + 25) % 50}', None)
+            shared['list'].append(i)
+            if len(shared['list']) > 100:
+                del shared['list'][:50]
+            shared['table'] = {'a': str(i)}
+            i += 1
+
+    def dump(_):
+        for _ in range(200):
+            assert isinstance(pytomlpp.loads(pytomlpp.dumps(shared)), dict)
+
+    with concurrent.futures.ThreadPoolExecutor(5) as pool:
+        mutator = pool.submit(mutate)
+        try:
+            list(pool.map(dump, range(4)))
+        finally:
+            stop = True
+        mutator.result()
+
+def test_cached_loader(tmp_path):
+    toml_file = tmp_path / "config.toml"
+    toml_file.write_text('a = 1\n[b]\nc = "x"\n', encoding="utf-8")
+    loader = pytomlpp.CachedLoader()
+    first = loader.load(toml_file)
+    first['a'] = 2
+    assert loader.load(str(toml_file)) == {'a': 1, 'b': {'c': 'x'}}
+    assert loader.stats()['hits'] == 1
+    assert loader.stats()['misses'] == 1
+    assert len(loader) == 1
+
+    # touched but unchanged: reused after comparing the content hash
+    stat = os.stat(toml_file)
+    os.utime(toml_file, ns=(stat.st_atime_ns, stat.st_mtime_ns + 10 ** 9))
+    assert loader.load(toml_file) == {'a': 1, 'b': {'c': 'x'}}
+    assert loader.stats()['content_hits'] == 1
+
+    toml_file.write_text('a = 3\n', encoding="utf-8")
+    assert loader.load(toml_file) == {'a': 3}
+    assert loader.stats()['misses'] == 2
+
+    lazy = loader.load(toml_file, lazy=True)
+    assert isinstance(lazy, pytomlpp.TomlTable)
+    assert lazy == {'a': 3}
+
+    loader.invalidate(toml_file)
+    assert len(loader) == 0
+
+def test_cached_loader_eviction_and_errors(tmp_path):
+    paths = []
+    for i in range(3):
+        path = tmp_path / f"{i}.toml"
+        path.write_text(f'value = {i}\n', encoding="utf-8")
+        paths.append(path)
+    loader = pytomlpp.CachedLoader(max_bytes=25)
+    for i, path in enumerate(paths):
+        assert loader.load(path) == {'value': i}
+    stats = loader.stats()
+    assert stats['entries'] == 2
+    assert stats['evictions'] == 1
+    assert stats['bytes'] <= 25
+    loader.clear()
+    assert len(loader) == 0
+
+    broken = tmp_path / "broken.toml"
+    broken.write_text('a = ', encoding="utf-8")
+    with pytest.raises(pytomlpp.DecodeError):
+        loader.load(broken)
+    with pytest.raises(OSError):
+        loader.load(tmp_path / "missing.toml")
+
+def test_config_set(tmp_path):
+    (tmp_path / "a.toml").write_text('x = 1\ny = 2\n', encoding="utf-8")
+    (tmp_path / "b.toml").write_text('z = 1\n', encoding="utf-8")
+    (tmp_path / "sub").mkdir()
+    (tmp_path / "sub" / "c.toml").write_text('w = [1]\n', encoding="utf-8")
+    configs = pytomlpp.ConfigSet(tmp_path, recursive=True, threads=2)
+    assert dict(configs) == {'a.toml': {'x': 1, 'y': 2}, 'b.toml': {'z': 1}, 'sub/c.toml': {'w': [1]}}
+    assert configs.refresh() == {}
+
+    (tmp_path / "a.toml").write_text('x = 1\ny = 3\nv = 0\n', encoding="utf-8")
+    (tmp_path / "b.toml").unlink()
+    (tmp_path / "d.toml").write_text('q = 1\n', encoding="utf-8")
+    changes = configs.refresh()
+    assert changes == {
+        'a.toml': pytomlpp.ConfigChange('modified', frozenset({'v'}), frozenset(), frozenset({'y'})),
+        'b.toml': pytomlpp.ConfigChange('removed', frozenset(), frozenset({'z'}), frozenset()),
+        'd.toml': pytomlpp.ConfigChange('added', frozenset({'q'}), frozenset(), frozenset()),
+    }
+    assert sorted(configs) == ['a.toml', 'd.toml', 'sub/c.toml']
+
+    # a broken file leaves the set as it was
+    (tmp_path / "d.toml").write_text('q = ', encoding="utf-8")
+    with pytest.raises(pytomlpp.DecodeError):
+        configs.refresh()
+    assert configs['d.toml'] == {'q': 1}
+
+def test_to_json(tmp_path):
+    text = 'a = 1\nb = [1.5, "x"]\n[c]\nd = true\n'
+    assert json.loads(pytomlpp.to_json(text)) == {'a': 1, 'b': [1.5, 'x'], 'c': {'d': True}}
+    toml_file = tmp_path / "data.toml"
+    toml_file.write_text(text, encoding="utf-8")
+    assert pytomlpp.to_json(toml_file) == pytomlpp.to_json(text.encode())
+    with pytest.raises(pytomlpp.DecodeError):
+        pytomlpp.to_json('a = ')
+
+def test_from_json(tmp_path):
+    document = {'a': 1, 'b': [1.5, 'x\u00e9\U0001F600'], 'c': {'d': True, 'e': [{'f': -2}]}}
+    text = json.dumps(document)
+    assert pytomlpp.loads(pytomlpp.from_json(text)) == document
+    json_file = tmp_path / "data.json"
+    json_file.write_text(text, encoding="utf-8")
+    assert pytomlpp.from_json(json_file) == pytomlpp.from_json(text.encode())
+    assert pytomlpp.loads(pytomlpp.from_json('{"big": 18446744073709551616}')) == {'big': 2.0 ** 64}
+    for invalid in ['{"a": null}', '[1]', '{"a": 1,}', '{"a": 01}', '{"a": "\\ud800"}']:
+        with pytest.raises(ValueError):
+            pytomlpp.from_json(invalid)
+
+@dataclasses.dataclass
+class _Server:
+    host: str
+    port: int
+    weight: float = 1.0
+    tags: typing.List[str] = dataclasses.field(default_factory=list)
+    alias: typing.Optional[str] = dataclasses.field(default=None, metadata={"toml": "alias-name"})
+
+@dataclasses.dataclass
+class _Config:
+    name: str
+    started: datetime.date
+    servers: typing.List[_Server]
+    limits: typing.Dict[str, typing.Union[int, str]]
+    owner: typing.Optional[str]
+
+_CONFIG_TEXT = """name = "svc"
+started = 2020-01-02
+limits = { cpu = 2, mem = "1G" }
+
+[[servers]]
+host = "a"
+port = 80
+weight = 2
+alias-name = "first"
+
+[[servers]]
+host = "b"
+port = 81
+tags = ["x"]
+"""
+
+def test_loads_as_dataclasses(tmp_path):
+    config = pytomlpp.loads_as(_CONFIG_TEXT, _Config)
+    assert config == _Config(
+        name='svc', started=datetime.date(2020, 1, 2),
+        servers=[_Server('a', 80, 2.0, [], 'first'), _Server('b', 81, 1.0, ['x'])],
+        limits={'cpu': 2, 'mem': '1G'}, owner=None)
+    assert isinstance(config.servers[0].weight, float)
+    toml_file = tmp_path / "config.toml"
+    toml_file.write_text(_CONFIG_TEXT, encoding="utf-8")
+    assert pytomlpp.load_as(toml_file, pytomlpp.Schema(_Config)) == config
+
+def test_loads_as_typeddict_and_builtins():
+    Limits = typing.TypedDict('Limits', {'cpu': int, 'mem': str}, total=False)
+    assert pytomlpp.loads_as('cpu = 1', Limits) == {'cpu': 1}
+    assert pytomlpp.loads_as('a = [1, 2]\nb = [3]', typing.Dict[str, typing.List[int]]) == {'a': [1, 2], 'b': [3]}
+    assert pytomlpp.loads_as('a = 1\nb = "x"', pytomlpp.Schema(Limits, extra="ignore")) == {}
+
+def test_loads_as_errors():
+    with pytest.raises(pytomlpp.SchemaError) as info:
+        pytomlpp.loads_as(_CONFIG_TEXT.replace('port = 81', 'port = "81"'), _Config)
+    assert isinstance(info.value, pytomlpp.DecodeError)
+    assert 'servers[1].port' in str(info.value)
+    assert info.value.start_line == 13
+    with pytest.raises(pytomlpp.SchemaError, match="missing key 'host'"):
+        pytomlpp.loads_as('name = "x"\nstarted = 2020-01-02\nlimits = {}\n[[servers]]\nport = 1', _Config)
+    with pytest.raises(pytomlpp.SchemaError, match="unknown key"):
+        pytomlpp.loads_as(_CONFIG_TEXT + 'extra = 1\n', _Config)
+    with pytest.raises(pytomlpp.SchemaError, match=r"int \| str"):
+        pytomlpp.loads_as('limits = { cpu = 1.5 }', typing.Dict[str, typing.Dict[str, typing.Union[int, str]]])
+    with pytest.raises(TypeError):
+        pytomlpp.Schema(typing.Dict[int, int])
+
+@pytest.mark.skipif(sys.version_info < (3, 9), reason="typing.Annotated is 3.9+")
+def test_loads_as_range():
+    Port = typing.Annotated[int, pytomlpp.Range(1, 65535)]
+    assert pytomlpp.loads_as('port = 80', typing.Dict[str, Port]) == {'port': 80}
+    with pytest.raises(pytomlpp.SchemaError, match="out of range"):
+        pytomlpp.loads_as('port = 70000', typing.Dict[str, Port])
+
+def test_profiling_stats():
+    pytomlpp.reset_stats()
+    pytomlpp.enable_profiling()
+    try:
+        assert pytomlpp.is_profiling_enabled()
+        text = 'a = 1\n[b]\nc = [1, 2]\n'
+        table = pytomlpp.loads(text)
+        pytomlpp.dumps(table)
+        stats = pytomlpp.get_stats()
+        assert stats['enabled']
+        parse = stats['phases']['loads.parse']
+        assert parse['count'] == 1
+        assert parse['min_ns'] <= parse['mean_ns'] <= parse['max_ns']
+        assert sum(parse['histogram'].values()) == 1
+        assert stats['counters']['bytes_in'] == len(text)
+        assert stats['counters']['bytes_out'] > 0
+        assert stats['counters']['nodes_decoded'] > 0
+        assert stats['counters']['nodes_encoded'] > 0
+        pytomlpp.reset_stats()
+        assert pytomlpp.get_stats()['phases'] == {}
+    finally:
+        pytomlpp.enable_profiling(False)
+    pytomlpp.loads('a = 1')
+    assert not pytomlpp.is_profiling_enabled()
+    assert pytomlpp.get_stats()['phases'] == {}